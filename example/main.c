@@ -2,6 +2,7 @@
 #include "xf_log.h"
 #include "xf_log_uitls.h"
 #include <time.h>
+#include <signal.h>
 
 #define TAG "main"
 
@@ -12,6 +13,13 @@ uint32_t get_current_time_ms(void)
     return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000ULL;
 }
 
+uint32_t get_current_time_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000ULL;
+}
+
 static void uart_write(const char *str, size_t len, void *arg)
 {
     // 逐字节发送字符串到“串口”
@@ -21,6 +29,11 @@ static void uart_write(const char *str, size_t len, void *arg)
     }
 }
 
+static void on_sigusr1(int sig)
+{
+    xf_log_callsite_dump_request(); // 收到信号后在下一次打印时输出最频繁的调用点
+}
+
 static void file_write(const char *str, size_t len, void *arg)
 {
     const char *file = (const char *)arg;
@@ -38,6 +51,8 @@ int main(void)
     int log_file_id = 0;
 
     xf_log_set_time_func(get_current_time_ms); // 设置时间戳打印函数(可选)
+    xf_log_set_tick_func(get_current_time_us); // 设置高精度计时函数，用于统计后端耗时(可选)
+    signal(SIGUSR1, on_sigusr1);               // kill -USR1 <pid> 即可输出最频繁的调用点
 
     log_uart_id = xf_log_register_obj(uart_write, NULL);
     xf_log_set_info_level(log_uart_id, XF_LOG_LVL_ERROR);
@@ -45,15 +60,16 @@ int main(void)
     log_file_id = xf_log_register_obj(file_write, "./log.log");
     xf_log_set_info_level(log_file_id, XF_LOG_LVL_VERBOSE); // 所有等级打印都带有全部信息
     xf_log_set_filter_colorful_disable(log_file_id);        // 不用彩色打印
-    xf_log_set_filter_file(log_file_id, __FILE__);          // 过滤文件名为__FILE__的打印
+    xf_log_set_filter_file(log_file_id, XF_LOG_FILE);        // 过滤文件名为XF_LOG_FILE的打印
     xf_log_set_filter_enable(log_file_id);                  // 打开过滤器
     xf_log_set_filter_is_blacklist(log_file_id);            // 设置过滤器为黑名单
+    xf_log_set_async_enable(log_file_id, XF_LOG_POLICY_DROP_OLDEST, 0); // 文件异步写入，队列满了丢弃最旧的记录
 
-    xf_log(XF_LOG_LVL_USER, TAG, __FILE__, __LINE__, __func__, "Hello, %.5s, date: %d, pi: %f!\n", name, date, pi);
+    xf_log(XF_LOG_LVL_USER, TAG, XF_LOG_FILE, __LINE__, __func__, "Hello, %.5s, date: %d, pi: %f!\n", name, date, pi);
     xf_log(XF_LOG_LVL_ERROR, TAG, "file1.c", __LINE__, __func__, "Hello, %s, date: %d, pi: %f!\n", name, date, pi);
-    xf_log(XF_LOG_LVL_WARN, TAG, __FILE__, __LINE__, __func__, "Hello, %s, date: %d, pi: %f!\n", name, date, pi);
+    xf_log(XF_LOG_LVL_WARN, TAG, XF_LOG_FILE, __LINE__, __func__, "Hello, %s, date: %d, pi: %f!\n", name, date, pi);
     xf_log(XF_LOG_LVL_INFO, TAG, "file2.c", __LINE__, __func__, "Hello, %s, date: %d, pi: %f!\n", name, date, pi);
-    xf_log(XF_LOG_LVL_DEBUG, TAG, __FILE__, __LINE__, __func__, "Hello, %s, date: %d, pi: %f!\n", name, date, pi);
+    xf_log(XF_LOG_LVL_DEBUG, TAG, XF_LOG_FILE, __LINE__, __func__, "Hello, %s, date: %d, pi: %f!\n", name, date, pi);
     xf_log(XF_LOG_LVL_VERBOSE, TAG, "file3.c", __LINE__, __func__, "Hello, %s, date: %d, pi: %f!\n", name, date, pi);
 
     xf_log_level(XF_LOG_LVL_USER, TAG, "Hello, %.5s, date: %d, pi: %f!", name, date, pi);
@@ -72,5 +88,10 @@ int main(void)
 
     xf_log_printf("Hello, %s, date: %d, pi: %f!\n", name, date, pi);
 
+    xf_log_flush(log_file_id); // 把队列中的记录写入文件
+    xf_log_stats_dump(-1);  // 输出各后端的统计计数
+    xf_log_callsite_dump(3); // 输出最频繁的 3 个调用点
+    xf_log_unregister_obj(log_file_id); // 注销文件后端，之后的打印只输出到串口
+
     return 0;
 }
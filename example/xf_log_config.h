@@ -14,6 +14,8 @@
 
 /* ==================== [Includes] ========================================== */
 
+#include <sched.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -21,6 +23,13 @@ extern "C" {
 /* ==================== [Defines] =========================================== */
 
 #define XF_LOG_OBJ_NUM           (2)
+#define XF_LOG_STATS_ENABLE      (1)
+#define XF_LOG_CALLSITE_ENABLE   (1)
+#define XF_LOG_ASYNC_ENABLE      (1)
+#define XF_LOG_DYNAMIC_ENABLE    (1)
+#define XF_LOG_LAYOUT_ENABLE     (1)
+
+#define xf_log_yield()           sched_yield()
 
 /* ==================== [Typedefs] ========================================== */
 
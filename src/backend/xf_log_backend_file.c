@@ -0,0 +1,354 @@
+/**
+ * @file xf_log_backend_file.c
+ * @author cangyu (sky.kirto@qq.com)
+ * @brief xf_log 文件后端，多个进程可以同时追加同一个文件，每条记录整体写入，按大小轮转。
+ * @version 0.1
+ * @date 2024-10-24
+ *
+ * @copyright Copyright (c) 2024, CorAL. All rights reserved.
+ *
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     // pthread_rwlockattr_setkind_np
+#endif
+
+#include "xf_log_backend_file.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+/* ==================== [Defines] =========================================== */
+
+#define XF_LOG_FILE_SUFFIX_SIZE (16)    // ".编号.idx" 的最大长度
+
+/* ==================== [Typedefs] ========================================== */
+
+/* ==================== [Static Prototypes] ================================= */
+
+static int xf_log_file_reopen(xf_log_file_t *file);
+static int xf_log_file_shift(xf_log_file_t *file, uint8_t force);
+static int xf_log_file_check(xf_log_file_t *file, uint8_t force);
+static int xf_log_file_write(int fd, const char *str, size_t len);
+static int xf_log_file_index_open(xf_log_file_t *file);
+static void xf_log_file_index_close(xf_log_file_t *file);
+static void xf_log_file_index_add(xf_log_file_t *file, size_t len);
+static void xf_log_file_index_flush(xf_log_file_t *file);
+
+/* ==================== [Static Variables] ================================== */
+
+/* ==================== [Macros] ============================================ */
+
+/* ==================== [Global Functions] ================================== */
+
+int xf_log_file_open(xf_log_file_t *file, const char *path, uint32_t max_size, uint32_t max_files)
+{
+    if (file == NULL || path == NULL || strlen(path) >= sizeof(file->path)) {
+        return -1;
+    }
+
+    memset(file, 0, sizeof(xf_log_file_t));
+    file->fd = -1;
+    file->idx_fd = -1;
+    strcpy(file->path, path);
+    file->max_size = max_size;
+    file->max_files = max_files ? max_files : 1;
+
+    // 写入线程一直持有读锁时，轮转也不能被饿死
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    int ret = pthread_rwlock_init(&file->lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+    if (ret != 0) {
+        return -1;
+    }
+    if (pthread_mutex_init(&file->big_lock, NULL) != 0) {
+        pthread_rwlock_destroy(&file->lock);
+        return -1;
+    }
+    if (xf_log_file_reopen(file) < 0) {
+        pthread_mutex_destroy(&file->big_lock);
+        pthread_rwlock_destroy(&file->lock);
+        return -1;
+    }
+
+    return 0;
+}
+
+void xf_log_file_close(xf_log_file_t *file)
+{
+    pthread_rwlock_wrlock(&file->lock);
+    xf_log_file_index_close(file);
+    if (file->fd >= 0) {
+        close(file->fd);
+        file->fd = -1;
+    }
+    pthread_rwlock_unlock(&file->lock);
+    pthread_mutex_destroy(&file->big_lock);
+    pthread_rwlock_destroy(&file->lock);
+}
+
+void xf_log_file_out(const char *str, size_t len, void *arg)
+{
+    xf_log_file_t *file = (xf_log_file_t *)arg;
+    int ret;
+
+    pthread_rwlock_rdlock(&file->lock);
+    if (file->idx_fd >= 0) {
+        // 索引块的范围需要包含本进程的每条记录，本进程内的写入和统计一起互斥
+        pthread_mutex_lock(&file->big_lock);
+        if (len > XF_LOG_FILE_ATOMIC_SIZE) {
+            flock(file->fd, LOCK_EX);
+        }
+        ret = xf_log_file_write(file->fd, str, len);
+        if (len > XF_LOG_FILE_ATOMIC_SIZE) {
+            flock(file->fd, LOCK_UN);
+        }
+        if (ret == 0) {
+            xf_log_file_index_add(file, len);
+        }
+        pthread_mutex_unlock(&file->big_lock);
+    } else if (len <= XF_LOG_FILE_ATOMIC_SIZE) {
+        // O_APPEND 下定位到末尾和写入是一个原子操作，一次 write 写完的记录不会与其他进程交错
+        ret = xf_log_file_write(file->fd, str, len);
+    } else {
+        // 长记录可能被拆成多次 write，持有文件锁避免与其他长记录交错
+        pthread_mutex_lock(&file->big_lock);
+        flock(file->fd, LOCK_EX);
+        ret = xf_log_file_write(file->fd, str, len);
+        flock(file->fd, LOCK_UN);
+        pthread_mutex_unlock(&file->big_lock);
+    }
+    pthread_rwlock_unlock(&file->lock);
+
+    if (ret < 0) {
+        xf_log_atomic_add(&file->dropped, 1);
+    }
+
+    // 按写入量间隔检查，只由累计到阈值的那个线程执行
+    uint32_t pending = xf_log_atomic_add(&file->pending, (uint32_t)len) + (uint32_t)len;
+    if (pending >= XF_LOG_FILE_CHECK_SIZE && xf_log_atomic_cas(&file->pending, &pending, 0)) {
+        xf_log_file_check(file, 0);
+    }
+}
+
+int xf_log_file_rotate(xf_log_file_t *file)
+{
+    return xf_log_file_check(file, 1);
+}
+
+int xf_log_file_set_index(xf_log_file_t *file, uint32_t block_size)
+{
+    int ret = 0;
+
+    if (block_size == 0) {
+        return -1;
+    }
+
+    pthread_rwlock_wrlock(&file->lock);
+    file->block_size = block_size;
+    if (file->idx_fd < 0) {
+        ret = xf_log_file_index_open(file);
+    }
+    pthread_rwlock_unlock(&file->lock);
+
+    return ret;
+}
+
+uint32_t xf_log_file_dropped(xf_log_file_t *file)
+{
+    return xf_log_atomic_load(&file->dropped);
+}
+
+/* ==================== [Static Functions] ================================== */
+
+static int xf_log_file_reopen(xf_log_file_t *file)
+{
+    struct stat st;
+    int fd = open(file->path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    // 旧文件的索引块写入旧的索引文件，它与旧文件一起被轮转
+    xf_log_file_index_close(file);
+    if (file->fd >= 0) {
+        close(file->fd);
+    }
+    file->fd = fd;
+    file->dev = st.st_dev;
+    file->ino = st.st_ino;
+
+    if (file->block_size) {
+        return xf_log_file_index_open(file);
+    }
+
+    return 0;
+}
+
+static int xf_log_file_shift(xf_log_file_t *file, uint8_t force)
+{
+    char from[XF_LOG_FILE_PATH_SIZE + XF_LOG_FILE_SUFFIX_SIZE];
+    char to[XF_LOG_FILE_PATH_SIZE + XF_LOG_FILE_SUFFIX_SIZE];
+    struct stat st;
+
+    // 持有当前文件的锁之后再确认一次，其他进程已经轮转过时只需要重新打开
+    flock(file->fd, LOCK_EX);
+    if (stat(file->path, &st) == 0 && st.st_dev == file->dev && st.st_ino == file->ino
+            && (force || st.st_size >= file->max_size)) {
+        // 索引文件先于日志文件轮转，其他进程发现日志文件轮转后打开的一定是新的索引文件
+        for (uint32_t i = file->max_files; i > 1; i--) {
+            snprintf(from, sizeof(from), "%s.%lu" XF_LOG_FILE_INDEX_SUFFIX, file->path, (unsigned long)(i - 1));
+            snprintf(to, sizeof(to), "%s.%lu" XF_LOG_FILE_INDEX_SUFFIX, file->path, (unsigned long)i);
+            rename(from, to);
+            snprintf(from, sizeof(from), "%s.%lu", file->path, (unsigned long)(i - 1));
+            snprintf(to, sizeof(to), "%s.%lu", file->path, (unsigned long)i);
+            rename(from, to);
+        }
+        snprintf(from, sizeof(from), "%s" XF_LOG_FILE_INDEX_SUFFIX, file->path);
+        snprintf(to, sizeof(to), "%s.1" XF_LOG_FILE_INDEX_SUFFIX, file->path);
+        rename(from, to);
+        snprintf(to, sizeof(to), "%s.1", file->path);
+        rename(file->path, to);
+    }
+    flock(file->fd, LOCK_UN);
+
+    return xf_log_file_reopen(file);
+}
+
+static int xf_log_file_check(xf_log_file_t *file, uint8_t force)
+{
+    struct stat st;
+    int ret = 0;
+
+    pthread_rwlock_wrlock(&file->lock);
+    if (stat(file->path, &st) < 0 || st.st_dev != file->dev || st.st_ino != file->ino) {
+        // 已被其他进程轮转或者删除
+        ret = xf_log_file_reopen(file);
+    } else if (force || (file->max_size && st.st_size >= file->max_size)) {
+        ret = xf_log_file_shift(file, force);
+    }
+    pthread_rwlock_unlock(&file->lock);
+
+    return ret;
+}
+
+static int xf_log_file_write(int fd, const char *str, size_t len)
+{
+    size_t n = 0;
+
+    while (n < len) {
+        ssize_t ret = write(fd, str + n, len - n);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        n += ret;
+    }
+
+    return 0;
+}
+
+static int xf_log_file_index_open(xf_log_file_t *file)
+{
+    char name[XF_LOG_FILE_PATH_SIZE + XF_LOG_FILE_SUFFIX_SIZE];
+
+    snprintf(name, sizeof(name), "%s" XF_LOG_FILE_INDEX_SUFFIX, file->path);
+    file->idx_fd = open(name, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (file->idx_fd < 0) {
+        return -1;
+    }
+
+    // 记下本进程开始写入的位置，查询时该位置之后还没有索引的部分需要整体扫描
+    memset(&file->block, 0, sizeof(xf_log_file_block_t));
+    file->block.offset = lseek(file->fd, 0, SEEK_END);
+    file->block.pid = getpid();
+    file->block_bytes = 0;
+    xf_log_file_write(file->idx_fd, (const char *)&file->block, sizeof(xf_log_file_block_t));
+
+    return 0;
+}
+
+static void xf_log_file_index_close(xf_log_file_t *file)
+{
+    if (file->idx_fd < 0) {
+        return;
+    }
+    xf_log_file_index_flush(file);
+
+    // 本进程不再写入该文件，查询时它最后一个块之后的部分不需要扫描
+    memset(&file->block, 0, sizeof(xf_log_file_block_t));
+    file->block.offset = lseek(file->fd, 0, SEEK_CUR);
+    file->block.pid = getpid();
+    file->block.flags = XF_LOG_FILE_BLOCK_CLOSED;
+    xf_log_file_write(file->idx_fd, (const char *)&file->block, sizeof(xf_log_file_block_t));
+
+    close(file->idx_fd);
+    file->idx_fd = -1;
+}
+
+static void xf_log_file_index_add(xf_log_file_t *file, size_t len)
+{
+    xf_log_file_block_t *block = &file->block;
+    uint8_t level = XF_LOG_LVL_NONE;
+    const char *tag = NULL;
+    uint32_t time = 0;
+
+#if XF_LOG_LINE_OUT_IS_ENABLE
+    const xf_log_line_info_t *info = xf_log_get_line_info();
+    if (info != NULL) {
+        level = info->level;
+        tag = info->tag;
+        time = info->time;
+    }
+#endif
+
+    // 块从本进程第一条记录的位置开始，O_APPEND 下 write 之后的位置减去长度即是记录的起始位置
+    if (file->block_bytes == 0) {
+        block->offset = lseek(file->fd, 0, SEEK_CUR) - len;
+        block->size = 0;
+        block->time_min = UINT32_MAX;
+        block->time_max = 0;
+        block->tags = 0;
+        block->levels = 0;
+        block->flags = 0;
+    }
+
+    block->levels |= 1U << (level & 7);
+    block->tags |= xf_log_file_tag_bit(tag);
+    if (level != XF_LOG_LVL_NONE) {
+        block->time_min = time < block->time_min ? time : block->time_min;
+        block->time_max = time > block->time_max ? time : block->time_max;
+    }
+    file->block_bytes += len;
+
+    if (file->block_bytes >= file->block_size) {
+        xf_log_file_index_flush(file);
+    }
+}
+
+static void xf_log_file_index_flush(xf_log_file_t *file)
+{
+    if (file->block_bytes == 0) {
+        return;
+    }
+
+    // 块到本进程最后一条记录的末尾为止
+    file->block.size = lseek(file->fd, 0, SEEK_CUR) - file->block.offset;
+    file->block.pid = getpid();
+    xf_log_file_write(file->idx_fd, (const char *)&file->block, sizeof(xf_log_file_block_t));
+    file->block_bytes = 0;
+}
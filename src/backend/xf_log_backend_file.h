@@ -0,0 +1,178 @@
+/**
+ * @file xf_log_backend_file.h
+ * @author cangyu (sky.kirto@qq.com)
+ * @brief xf_log 文件后端，多个进程可以同时追加同一个文件，每条记录整体写入，按大小轮转。
+ * @version 0.1
+ * @date 2024-10-24
+ *
+ * @copyright Copyright (c) 2024, CorAL. All rights reserved.
+ *
+ */
+
+#ifndef __XF_LOG_BACKEND_FILE_H__
+#define __XF_LOG_BACKEND_FILE_H__
+
+/* ==================== [Includes] ========================================== */
+
+#include "xf_log.h"
+#include <limits.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ==================== [Defines] =========================================== */
+
+// 文件路径的最大长度
+#ifndef XF_LOG_FILE_PATH_SIZE
+#define XF_LOG_FILE_PATH_SIZE (256)
+#endif
+
+// 不超过此长度的记录直接以一次 O_APPEND write 写入，不加锁；更长的记录持有文件锁写入
+#ifndef XF_LOG_FILE_ATOMIC_SIZE
+#define XF_LOG_FILE_ATOMIC_SIZE (PIPE_BUF)
+#endif
+
+// 本进程每写入多少字节检查一次文件大小，以及文件是否已被其他进程轮转
+#ifndef XF_LOG_FILE_CHECK_SIZE
+#define XF_LOG_FILE_CHECK_SIZE (16 * 1024)
+#endif
+
+// 索引文件名在日志文件名之后追加的后缀，轮转后的 path.1 对应 path.1.idx
+#define XF_LOG_FILE_INDEX_SUFFIX ".idx"
+
+// 索引块的标志，进程关闭或者轮转离开该文件，之后不会再有它未索引的记录
+#define XF_LOG_FILE_BLOCK_CLOSED (0x01)
+
+/* ==================== [Typedefs] ========================================== */
+
+/**
+ * @brief 索引文件中的一项，描述本进程写入的一段日志。
+ *
+ * 块的范围内可能夹杂其他进程的记录，时间、等级和 tag 只统计写入该块的进程自己的记录。
+ */
+typedef struct _xf_log_file_block_t {
+    uint64_t offset;            /*!< 块在日志文件中的起始位置，不轮转时文件可以超过 4 GiB */
+    uint64_t size;              /*!< 块的长度，为 0 表示进程从 offset 开始写入该文件或者已离开该文件 */
+    uint32_t time_min;          /*!< 块中记录的最小时间戳 */
+    uint32_t time_max;          /*!< 块中记录的最大时间戳，小于 time_min 表示没有带时间戳的记录 */
+    uint32_t tags;              /*!< 块中出现过的 tag，见 xf_log_file_tag_bit */
+    uint32_t pid;               /*!< 写入该块的进程号 */
+    uint8_t levels;             /*!< 块中出现过的等级，按 1 << level 置位，xf_log_printf 的输出为 XF_LOG_LVL_NONE */
+    uint8_t flags;              /*!< 块的标志，见 XF_LOG_FILE_BLOCK_CLOSED */
+    uint8_t reserved[6];
+} xf_log_file_block_t;
+
+/**
+ * @brief 文件后端的句柄，每个进程各自持有。
+ */
+typedef struct _xf_log_file_t {
+    int fd;                             /*!< 以 O_APPEND 打开的文件 */
+    dev_t dev;                          /*!< fd 对应文件所在的设备，用于发现其他进程的轮转 */
+    ino_t ino;                          /*!< fd 对应文件的 inode */
+    char path[XF_LOG_FILE_PATH_SIZE];   /*!< 文件路径 */
+    pthread_rwlock_t lock;              /*!< 本进程内写入时持有读锁，切换文件时持有写锁 */
+    pthread_mutex_t big_lock;           /*!< 本进程内长记录之间互斥，开启索引时所有记录互斥 */
+    uint32_t max_size;                  /*!< 文件超过此大小后轮转，为 0 时不轮转 */
+    uint32_t max_files;                 /*!< 轮转时保留的旧文件数，path.1 最新 */
+    uint32_t pending;                   /*!< 上一次检查之后本进程写入的字节数 */
+    uint32_t dropped;                   /*!< 写入失败的记录数 */
+    int idx_fd;                         /*!< 以 O_APPEND 打开的索引文件，未开启索引时为 -1 */
+    uint32_t block_size;                /*!< 本进程写入多少字节后生成一个索引块 */
+    uint32_t block_bytes;               /*!< 当前块中本进程已写入的字节数 */
+    xf_log_file_block_t block;          /*!< 正在统计的索引块 */
+} xf_log_file_t;
+
+/* ==================== [Global Prototypes] ================================= */
+
+/**
+ * @brief 打开文件后端，文件不存在时创建
+ *
+ * 各个进程用相同的参数各自打开同一个路径即可，不需要额外的协调进程。
+ *
+ * @param file 文件后端句柄
+ * @param path 文件路径
+ * @param max_size 文件超过此大小后轮转，为 0 时不轮转
+ * @param max_files 轮转时保留的旧文件数 path.1 ~ path.max_files，最少为 1
+ * @return int  -1:失败, 0:成功
+ */
+int xf_log_file_open(xf_log_file_t *file, const char *path, uint32_t max_size, uint32_t max_files);
+
+/**
+ * @brief 关闭文件后端
+ *
+ * @param file 文件后端句柄
+ */
+void xf_log_file_close(xf_log_file_t *file);
+
+/**
+ * @brief 文件后端的输出函数，参数为 xf_log_file_t 句柄
+ *
+ * 每次调用作为一条记录整体追加，需配合 xf_log_set_line_out_enable 使用，
+ * 否则一条记录会被拆成多次写入，与其他进程的记录交错。
+ *
+ * @param str 交由后端输出的字符串
+ * @param len 字符串的长度
+ * @param arg 文件后端句柄
+ */
+void xf_log_file_out(const char *str, size_t len, void *arg);
+
+/**
+ * @brief 立即轮转文件，多个进程同时调用时只轮转一次
+ *
+ * @param file 文件后端句柄
+ * @return int  -1:失败, 0:成功
+ */
+int xf_log_file_rotate(xf_log_file_t *file);
+
+/**
+ * @brief 开启索引，之后本进程写入的记录按块统计时间、等级和 tag，追加到 path.idx
+ *
+ * 查询时只需要读取时间、等级和 tag 符合条件的块，见 tools/xf_log_file_query。
+ * 等级、tag 和时间戳来自 xf_log_get_line_info，需要开启整行输出。
+ * 开启索引后同一进程内的写入互斥，进程之间仍然不加锁。
+ * 索引中的偏移为 64 位，不轮转时文件可以超过 4 GiB；32 位系统上整个工程需要以 -D_FILE_OFFSET_BITS=64 编译。
+ *
+ * @param file 文件后端句柄
+ * @param block_size 本进程每写入多少字节生成一个索引块
+ * @return int  -1:失败, 0:成功
+ */
+int xf_log_file_set_index(xf_log_file_t *file, uint32_t block_size);
+
+/**
+ * @brief 获取写入失败的记录数
+ *
+ * @param file 文件后端句柄
+ * @return uint32_t 写入失败的记录数
+ */
+uint32_t xf_log_file_dropped(xf_log_file_t *file);
+
+/* ==================== [Macros] ============================================ */
+
+/**
+ * @brief 计算 tag 在索引块 tags 中对应的位，不同的 tag 可能对应同一位
+ *
+ * @param tag 记录的标签
+ * @return uint32_t tag 对应的位，tag 为 NULL 时为 0
+ */
+static inline uint32_t xf_log_file_tag_bit(const char *tag)
+{
+    uint32_t hash = 2166136261UL;
+
+    if (tag == NULL) {
+        return 0;
+    }
+    while (*tag) {
+        hash = (hash ^ (uint8_t)*tag++) * 16777619UL;
+    }
+
+    return 1UL << (hash & 31);
+}
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif // __XF_LOG_BACKEND_FILE_H__
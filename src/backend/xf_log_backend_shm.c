@@ -0,0 +1,338 @@
+/**
+ * @file xf_log_backend_shm.c
+ * @author cangyu (sky.kirto@qq.com)
+ * @brief xf_log 共享内存后端，记录写入共享内存环，由独立的收集进程负责输出。
+ * @version 0.1
+ * @date 2024-10-21
+ *
+ * @copyright Copyright (c) 2024, CorAL. All rights reserved.
+ *
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#include "xf_log_backend_shm.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+/* ==================== [Defines] =========================================== */
+
+#define XF_LOG_SHM_MAGIC        (0x474F4C58UL)  // "XLOG"
+#define XF_LOG_SHM_HEAD_SIZE    (64)            // 头部独占一个缓存行，槽位从这里开始
+
+/* ==================== [Typedefs] ========================================== */
+
+typedef struct _xf_log_shm_slot_t {
+    uint32_t seq;           // 等于序号表示空闲可写，等于序号加一表示已提交
+    uint32_t pid;           // 写入进程号，空闲时为 0
+    uint32_t len;
+    char data[];
+} xf_log_shm_slot_t;
+
+/* ==================== [Static Prototypes] ================================= */
+
+static xf_log_shm_slot_t *xf_log_shm_slot(xf_log_shm_head_t *head, uint32_t pos);
+static uint32_t xf_log_shm_now(void);
+static int xf_log_shm_recover(xf_log_shm_t *shm, xf_log_shm_slot_t *slot, uint32_t pos,
+                              xf_log_out_t out_func, void *user_args);
+static void xf_log_shm_release(xf_log_shm_head_t *head, xf_log_shm_slot_t *slot, uint32_t pos);
+
+/* ==================== [Static Variables] ================================== */
+
+/* ==================== [Macros] ============================================ */
+
+#define xf_log_futex(addr, op, val, ts) syscall(SYS_futex, (addr), (op), (val), (ts), NULL, 0)
+
+/* ==================== [Global Functions] ================================== */
+
+int xf_log_shm_open(xf_log_shm_t *shm, const char *name, uint32_t slot_num, uint32_t slot_size)
+{
+    struct stat st;
+    size_t size = 0;
+    int created = 1;
+
+    if (shm == NULL || name == NULL || slot_num == 0 || (slot_num & (slot_num - 1))
+            || slot_size <= sizeof(xf_log_shm_slot_t)) {
+        return -1;
+    }
+    slot_size = (slot_size + 7) & ~7U;
+
+    // 只有创建者负责初始化，其他进程等待初始化完成
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        if (errno != EEXIST) {
+            return -1;
+        }
+        created = 0;
+        fd = shm_open(name, O_RDWR, 0600);
+        if (fd < 0) {
+            return -1;
+        }
+    }
+
+    if (created) {
+        size = XF_LOG_SHM_HEAD_SIZE + (size_t)slot_num * slot_size;
+        if (ftruncate(fd, size) < 0) {
+            close(fd);
+            shm_unlink(name);
+            return -1;
+        }
+    } else {
+        for (size_t k = 0; fstat(fd, &st) == 0 && st.st_size < XF_LOG_SHM_HEAD_SIZE; k++) {
+            if (k >= XF_LOG_SHM_ORPHAN_MS) {
+                close(fd);
+                return -1;
+            }
+            usleep(1000);
+        }
+        size = st.st_size;
+    }
+
+    xf_log_shm_head_t *head = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (head == MAP_FAILED) {
+        return -1;
+    }
+
+    if (created) {
+        head->slot_num = slot_num;
+        head->slot_size = slot_size;
+        for (uint32_t i = 0; i < slot_num; i++) {
+            xf_log_shm_slot(head, i)->seq = i;
+        }
+        xf_log_atomic_store_release(&head->magic, XF_LOG_SHM_MAGIC);
+    } else {
+        for (size_t k = 0; xf_log_atomic_load_acquire(&head->magic) != XF_LOG_SHM_MAGIC; k++) {
+            if (k >= XF_LOG_SHM_ORPHAN_MS) {
+                munmap(head, size);
+                return -1;
+            }
+            usleep(1000);
+        }
+        if (XF_LOG_SHM_HEAD_SIZE + (size_t)head->slot_num * head->slot_size > size) {
+            munmap(head, size);
+            return -1;
+        }
+    }
+
+    shm->head = head;
+    shm->size = size;
+    shm->pid = getpid();
+    shm->stall_pos = 0;
+    shm->stall_time = 0;
+
+    return 0;
+}
+
+void xf_log_shm_close(xf_log_shm_t *shm)
+{
+    if (shm->head != NULL) {
+        munmap(shm->head, shm->size);
+        shm->head = NULL;
+    }
+}
+
+int xf_log_shm_unlink(const char *name)
+{
+    return shm_unlink(name);
+}
+
+void xf_log_shm_out(const char *str, size_t len, void *arg)
+{
+    xf_log_shm_t *shm = (xf_log_shm_t *)arg;
+    xf_log_shm_head_t *head = shm->head;
+    xf_log_shm_slot_t *slot = NULL;
+    uint32_t pos = xf_log_atomic_load(&head->head);
+
+    // 申请槽位：槽位的序号与申请的序号一致时才可写，环满时直接丢弃，不等待收集进程
+    // 推进 head 之前先把进程号写入槽位，收集进程看到的已申请槽位一定带有写入者的进程号
+    while (1) {
+        slot = xf_log_shm_slot(head, pos);
+        int32_t diff = (int32_t)(xf_log_atomic_load_acquire(&slot->seq) - pos);
+        if (diff == 0) {
+            uint32_t owner = 0;
+            if (!xf_log_atomic_cas(&slot->pid, &owner, shm->pid)) {
+                // 另一个写入者正在申请，若它在推进 head 之前崩溃则替它放弃
+                if (xf_log_atomic_load(&head->head) == pos
+                        && kill(owner, 0) < 0 && errno == ESRCH) {
+                    xf_log_atomic_cas(&slot->pid, &owner, 0);
+                }
+                pos = xf_log_atomic_load(&head->head);
+                continue;
+            }
+            if (xf_log_atomic_load_acquire(&slot->seq) == pos
+                    && xf_log_atomic_cas(&head->head, &pos, pos + 1)) {
+                break;
+            }
+            xf_log_atomic_store_release(&slot->pid, 0);
+            pos = xf_log_atomic_load(&head->head);
+        } else if (diff < 0) {
+            xf_log_atomic_add(&head->dropped, 1);
+            return;
+        } else {
+            pos = xf_log_atomic_load(&head->head);
+        }
+    }
+
+    size_t cap = head->slot_size - sizeof(xf_log_shm_slot_t);
+    if (len > cap) {
+        len = cap;
+    }
+    xf_log_atomic_store(&slot->len, len);
+    memcpy(slot->data, str, len);
+
+    // 提交失败说明停顿太久，槽位已被收集进程当作崩溃回收
+    uint32_t expected = pos;
+    if (!xf_log_atomic_cas(&slot->seq, &expected, pos + 1)) {
+        xf_log_atomic_add(&head->dropped, 1);
+        return;
+    }
+
+    // 只有收集进程在等待时才需要系统调用
+    xf_log_atomic_fence();
+    if (xf_log_atomic_load(&head->sleeping)) {
+        xf_log_atomic_add(&head->wake, 1);
+        xf_log_futex(&head->wake, FUTEX_WAKE, 1, NULL);
+    }
+}
+
+size_t xf_log_shm_read(xf_log_shm_t *shm, xf_log_out_t out_func, void *user_args, uint32_t timeout)
+{
+    xf_log_shm_head_t *head = shm->head;
+    size_t count = 0;
+
+    while (1) {
+        uint32_t pos = head->tail;
+        xf_log_shm_slot_t *slot = xf_log_shm_slot(head, pos);
+
+        if (xf_log_atomic_load_acquire(&slot->seq) == pos + 1) {
+            size_t len = slot->len;
+            size_t cap = head->slot_size - sizeof(xf_log_shm_slot_t);
+            out_func(slot->data, len < cap ? len : cap, user_args);
+            xf_log_shm_release(head, slot, pos);
+            count++;
+            continue;
+        }
+
+        // 已被申请但还没有提交的槽位，写入者可能已经崩溃
+        if ((int32_t)(xf_log_atomic_load_acquire(&head->head) - pos) > 0
+                && xf_log_shm_recover(shm, slot, pos, out_func, user_args)) {
+            count++;
+            continue;
+        }
+        if (count || timeout == 0) {
+            break;
+        }
+
+        // 先声明正在等待再检查一次，与 xf_log_shm_out 中的屏障配对，避免错过唤醒
+        uint32_t wake = xf_log_atomic_load(&head->wake);
+        xf_log_atomic_store(&head->sleeping, 1);
+        xf_log_atomic_fence();
+        if (xf_log_atomic_load_acquire(&slot->seq) != pos + 1) {
+            uint32_t wait = timeout < XF_LOG_SHM_STALL_MS ? timeout : XF_LOG_SHM_STALL_MS;
+            struct timespec ts = {wait / 1000, (wait % 1000) * 1000000L};
+            xf_log_futex(&head->wake, FUTEX_WAIT, wake, &ts);
+        }
+        xf_log_atomic_store(&head->sleeping, 0);
+        timeout = 0;
+    }
+
+    return count;
+}
+
+uint32_t xf_log_shm_dropped(xf_log_shm_t *shm)
+{
+    return xf_log_atomic_load(&shm->head->dropped);
+}
+
+/* ==================== [Static Functions] ================================== */
+
+static xf_log_shm_slot_t *xf_log_shm_slot(xf_log_shm_head_t *head, uint32_t pos)
+{
+    char *base = (char *)head + XF_LOG_SHM_HEAD_SIZE;
+    return (xf_log_shm_slot_t *)(base + (size_t)(pos & (head->slot_num - 1)) * head->slot_size);
+}
+
+static uint32_t xf_log_shm_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000UL + ts.tv_nsec / 1000000UL;
+}
+
+static int xf_log_shm_recover(xf_log_shm_t *shm, xf_log_shm_slot_t *slot, uint32_t pos,
+                              xf_log_out_t out_func, void *user_args)
+{
+    uint32_t now = xf_log_shm_now();
+
+    // 同一个槽位停留一段时间后才检查，正常的写入者很快就会提交
+    if (shm->stall_pos != pos + 1) {
+        shm->stall_pos = pos + 1;
+        shm->stall_time = now;
+        return 0;
+    }
+    uint32_t pid = xf_log_atomic_load(&slot->pid);
+    if (now - shm->stall_time < XF_LOG_SHM_STALL_MS) {
+        return 0;
+    }
+    // 已申请的槽位一定带有进程号，为 0 说明写入者刚好已经提交
+    if (pid == 0 || !(kill(pid, 0) < 0 && errno == ESRCH)) {
+        return 0;
+    }
+    size_t len = xf_log_atomic_load(&slot->len);
+
+    // 与写入者的提交竞争，回收成功后写入者会放弃提交
+    // 先改为 pos - 1 占住槽位，既不是已提交也不是空闲，输出完之前不会被重新申请
+    uint32_t expected = pos;
+    if (!xf_log_atomic_cas(&slot->seq, &expected, pos - 1)) {
+        return 0;
+    }
+    shm->stall_pos = 0;
+
+    // 写入者已经不存在，输出槽位中可能不完整的内容后跳过
+    char msg[64] = "xf_log_shm: partial record from crashed pid ";
+    size_t n = strlen(msg);
+    uint32_t val = pid;
+    char tmp[10];
+    size_t k = 0;
+    do {
+        tmp[k++] = '0' + val % 10;
+        val /= 10;
+    } while (val);
+    while (k) {
+        msg[n++] = tmp[--k];
+    }
+    msg[n++] = '\n';
+    out_func(msg, n, user_args);
+
+    size_t cap = shm->head->slot_size - sizeof(xf_log_shm_slot_t);
+    if (len > 0) {
+        len = len < cap ? len : cap;
+        out_func(slot->data, len, user_args);
+        if (slot->data[len - 1] != '\n') {
+            out_func("\n", 1, user_args);
+        }
+    }
+
+    // 回收成功后才清除进程号并归还槽位
+    xf_log_shm_release(shm->head, slot, pos);
+
+    return 1;
+}
+
+static void xf_log_shm_release(xf_log_shm_head_t *head, xf_log_shm_slot_t *slot, uint32_t pos)
+{
+    // 清除进程号后再归还槽位，下一次写入前的进程号为 0
+    xf_log_atomic_store(&slot->pid, 0);
+    xf_log_atomic_store(&slot->len, 0);
+    xf_log_atomic_store_release(&slot->seq, pos + head->slot_num);
+    xf_log_atomic_store(&head->tail, pos + 1);
+}
@@ -0,0 +1,132 @@
+/**
+ * @file xf_log_backend_shm.h
+ * @author cangyu (sky.kirto@qq.com)
+ * @brief xf_log 共享内存后端，记录写入共享内存环，由独立的收集进程负责输出。
+ * @version 0.1
+ * @date 2024-10-21
+ *
+ * @copyright Copyright (c) 2024, CorAL. All rights reserved.
+ *
+ */
+
+#ifndef __XF_LOG_BACKEND_SHM_H__
+#define __XF_LOG_BACKEND_SHM_H__
+
+/* ==================== [Includes] ========================================== */
+
+#include "xf_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ==================== [Defines] =========================================== */
+
+// 槽位已被申请但迟迟没有提交时，间隔多久检查一次写入进程是否还存在，单位 ms
+#ifndef XF_LOG_SHM_STALL_MS
+#define XF_LOG_SHM_STALL_MS (100)
+#endif
+
+// 打开已存在的共享内存时，等待创建者完成初始化的最长时间，单位 ms
+#ifndef XF_LOG_SHM_ORPHAN_MS
+#define XF_LOG_SHM_ORPHAN_MS (1000)
+#endif
+
+/* ==================== [Typedefs] ========================================== */
+
+/**
+ * @brief 共享内存环的头部，位于共享内存起始处。
+ */
+typedef struct _xf_log_shm_head_t {
+    uint32_t magic;             /*!< 初始化完成后写入，其他进程据此判断是否可用 */
+    uint32_t slot_num;          /*!< 槽位数，2 的幂 */
+    uint32_t slot_size;         /*!< 每个槽位的字节数，包含槽位头 */
+    uint32_t head;              /*!< 生产者下一次申请的序号 */
+    uint32_t tail;              /*!< 收集进程下一次读取的序号 */
+    uint32_t wake;              /*!< futex 字，唤醒收集进程时加一 */
+    uint32_t sleeping;          /*!< 收集进程是否正在等待 */
+    uint32_t dropped;           /*!< 环满时丢弃的记录数 */
+} xf_log_shm_head_t;
+
+/**
+ * @brief 共享内存环的句柄，每个进程各自持有。
+ */
+typedef struct _xf_log_shm_t {
+    xf_log_shm_head_t *head;    /*!< 映射后的共享内存 */
+    size_t size;                /*!< 映射的字节数 */
+    uint32_t pid;               /*!< 本进程号，fork 之后需要重新打开 */
+    uint32_t stall_pos;         /*!< 收集进程：正在等待提交的序号 */
+    uint32_t stall_time;        /*!< 收集进程：开始等待的时间 */
+} xf_log_shm_t;
+
+/* ==================== [Global Prototypes] ================================= */
+
+/**
+ * @brief 打开共享内存环，不存在时按给定的大小创建
+ *
+ * 已经存在时沿用创建者的槽位数和槽位大小，生产者和收集进程都可以先启动。
+ *
+ * @param shm 共享内存环句柄
+ * @param name 共享内存的名字，如 "/xf_log"
+ * @param slot_num 槽位数，必须是 2 的幂
+ * @param slot_size 每个槽位的字节数，包含 12 字节的槽位头
+ * @return int  -1:失败, 0:成功
+ */
+int xf_log_shm_open(xf_log_shm_t *shm, const char *name, uint32_t slot_num, uint32_t slot_size);
+
+/**
+ * @brief 关闭共享内存环，不会删除共享内存
+ *
+ * @param shm 共享内存环句柄
+ */
+void xf_log_shm_close(xf_log_shm_t *shm);
+
+/**
+ * @brief 删除共享内存，已经打开的进程不受影响
+ *
+ * @param name 共享内存的名字
+ * @return int  -1:失败, 0:成功
+ */
+int xf_log_shm_unlink(const char *name);
+
+/**
+ * @brief 共享内存后端的输出函数，参数为 xf_log_shm_t 句柄
+ *
+ * 每次调用写入一个槽位，需配合 xf_log_set_line_out_enable 使用，保证一条记录占用一个槽位。
+ * 环满时直接丢弃，收集进程正在等待时才会产生一次唤醒的系统调用。
+ * 也可以作为异步后端的输出函数，由 xf_log_flush 写入共享内存。
+ *
+ * @param str 交由后端输出的字符串
+ * @param len 字符串的长度，超出槽位的部分会被截断
+ * @param arg 共享内存环句柄
+ */
+void xf_log_shm_out(const char *str, size_t len, void *arg);
+
+/**
+ * @brief 收集进程读取共享内存环中的记录
+ *
+ * 写入进程崩溃导致槽位一直没有提交时，会输出一条提示以及槽位中已经写入的内容，然后跳过该槽位。
+ *
+ * @param shm 共享内存环句柄
+ * @param out_func 记录的输出函数
+ * @param user_args 传入的参数，会在 out_func 中被调用
+ * @param timeout 没有记录时的最长等待时间，单位 ms，为 0 时不等待
+ * @return size_t 读取的记录数
+ */
+size_t xf_log_shm_read(xf_log_shm_t *shm, xf_log_out_t out_func, void *user_args, uint32_t timeout);
+
+/**
+ * @brief 获取环满时丢弃的记录数
+ *
+ * @param shm 共享内存环句柄
+ * @return uint32_t 累计丢弃的记录数
+ */
+uint32_t xf_log_shm_dropped(xf_log_shm_t *shm);
+
+/* ==================== [Macros] ============================================ */
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif // __XF_LOG_BACKEND_SHM_H__
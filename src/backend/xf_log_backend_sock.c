@@ -0,0 +1,361 @@
+/**
+ * @file xf_log_backend_sock.c
+ * @author cangyu (sky.kirto@qq.com)
+ * @brief xf_log 本地套接字后端，按记录发送 Unix 数据报，可选 RFC 5424 syslog 格式。
+ * @version 0.1
+ * @date 2024-10-22
+ *
+ * @copyright Copyright (c) 2024, CorAL. All rights reserved.
+ *
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     // sendmmsg
+#endif
+
+#include "xf_log_backend_sock.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ==================== [Defines] =========================================== */
+
+#define XF_LOG_SOCK_MSGID_MAX   (32)    // RFC 5424 中 MSGID 的最大长度
+#define XF_LOG_SOCK_CSI_END     "\033[0m" // 彩色输出结尾的样式复位
+
+/* ==================== [Typedefs] ========================================== */
+
+/* ==================== [Static Prototypes] ================================= */
+
+static uint32_t xf_log_sock_now(void);
+static int xf_log_sock_connect(xf_log_sock_t *sock);
+static size_t xf_log_sock_frame(xf_log_sock_t *sock, char *dst, const char *str, size_t len,
+                                uint8_t level, const char *tag, const char *fmt, va_list *va);
+static void xf_log_sock_push(xf_log_sock_t *sock, const char *str, size_t len, uint8_t level, const char *tag,
+                             const char *fmt, va_list *va);
+static size_t xf_log_sock_send(xf_log_sock_t *sock);
+
+/* ==================== [Static Variables] ================================== */
+
+// XF_LOG_LVL_* 到 syslog severity 的映射，xf_log_printf 的输出按 informational 处理
+static const uint8_t s_lvl_to_severity[] = {
+    6,  // NONE -> informational
+    5,  // USER -> notice
+    3,  // ERROR -> error
+    4,  // WARN -> warning
+    6,  // INFO -> informational
+    7,  // DEBUG -> debug
+    7,  // VERBOSE -> debug
+};
+
+/* ==================== [Macros] ============================================ */
+
+// 丢弃时比较的严重程度，数值越大越不重要，xf_log_printf 的输出 (NONE) 视为最不重要
+#define XF_LOG_SOCK_RANK(level) ((level) == XF_LOG_LVL_NONE ? XF_LOG_LVL_VERBOSE + 1 : (level))
+
+/* ==================== [Global Functions] ================================== */
+
+int xf_log_sock_open(xf_log_sock_t *sock, const char *path, xf_log_sock_format_t format)
+{
+    if (sock == NULL || path == NULL || strlen(path) >= sizeof(sock->addr.sun_path)) {
+        return -1;
+    }
+
+    memset(sock, 0, sizeof(xf_log_sock_t));
+    sock->fd = -1;
+    sock->addr.sun_family = AF_UNIX;
+    strcpy(sock->addr.sun_path, path);
+    sock->format = format;
+    sock->policy = XF_LOG_SOCK_DROP_OLDEST;
+    sock->facility = 1;
+    sock->app_name = "xf_log";
+    sock->batch_num = XF_LOG_SOCK_BATCH_NUM;
+    sock->latency = 100;
+    if (gethostname(sock->hostname, sizeof(sock->hostname) - 1) < 0 || sock->hostname[0] == '\0') {
+        strcpy(sock->hostname, "-");
+    }
+    if (pthread_mutex_init(&sock->lock, NULL) != 0) {
+        return -1;
+    }
+
+    // 接收端还不在时同样返回成功，之后发送时重连
+    sock->retry_time = xf_log_sock_now();
+    xf_log_sock_connect(sock);
+
+    return 0;
+}
+
+void xf_log_sock_close(xf_log_sock_t *sock)
+{
+    xf_log_sock_flush(sock);
+
+    pthread_mutex_lock(&sock->lock);
+    if (sock->fd >= 0) {
+        close(sock->fd);
+        sock->fd = -1;
+    }
+    pthread_mutex_unlock(&sock->lock);
+    pthread_mutex_destroy(&sock->lock);
+}
+
+void xf_log_sock_set_batch(xf_log_sock_t *sock, uint32_t num, uint32_t latency)
+{
+    pthread_mutex_lock(&sock->lock);
+    sock->batch_num = (num == 0 || num > XF_LOG_SOCK_BATCH_NUM) ? XF_LOG_SOCK_BATCH_NUM : num;
+    sock->latency = latency;
+    pthread_mutex_unlock(&sock->lock);
+}
+
+void xf_log_sock_set_policy(xf_log_sock_t *sock, xf_log_sock_policy_t policy)
+{
+    sock->policy = policy;
+}
+
+void xf_log_sock_set_syslog(xf_log_sock_t *sock, uint8_t facility, const char *app_name)
+{
+    sock->facility = facility;
+    sock->app_name = app_name;
+}
+
+void xf_log_sock_out(const char *str, size_t len, void *arg)
+{
+    xf_log_sock_t *sock = (xf_log_sock_t *)arg;
+    uint8_t level = XF_LOG_LVL_NONE;
+    const char *tag = NULL;
+    const char *fmt = NULL;
+    va_list *va = NULL;
+
+#if XF_LOG_LINE_OUT_IS_ENABLE
+    const xf_log_line_info_t *info = xf_log_get_line_info();
+    if (info != NULL) {
+        level = info->level;
+        tag = info->tag;
+        fmt = info->fmt;
+        va = info->va;
+    }
+#endif
+
+    pthread_mutex_lock(&sock->lock);
+    xf_log_sock_push(sock, str, len, level, tag, fmt, va);
+
+    // 攒够一批或者最旧的记录等待太久时发送
+    if (sock->count >= sock->batch_num || xf_log_sock_now() - sock->first_time >= sock->latency) {
+        xf_log_sock_send(sock);
+    }
+    pthread_mutex_unlock(&sock->lock);
+}
+
+size_t xf_log_sock_poll(xf_log_sock_t *sock)
+{
+    size_t count = 0;
+
+    pthread_mutex_lock(&sock->lock);
+    if ((sock->count || sock->unreported) && xf_log_sock_now() - sock->first_time >= sock->latency) {
+        count = xf_log_sock_send(sock);
+    }
+    pthread_mutex_unlock(&sock->lock);
+
+    return count;
+}
+
+size_t xf_log_sock_flush(xf_log_sock_t *sock)
+{
+    pthread_mutex_lock(&sock->lock);
+    size_t count = xf_log_sock_send(sock);
+    pthread_mutex_unlock(&sock->lock);
+
+    return count;
+}
+
+uint32_t xf_log_sock_dropped(xf_log_sock_t *sock)
+{
+    return xf_log_atomic_load(&sock->dropped);
+}
+
+/* ==================== [Static Functions] ================================== */
+
+static uint32_t xf_log_sock_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000UL + ts.tv_nsec / 1000000UL;
+}
+
+static int xf_log_sock_connect(xf_log_sock_t *sock)
+{
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&sock->addr, sizeof(sock->addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    sock->fd = fd;
+
+    return 0;
+}
+
+static size_t xf_log_sock_frame(xf_log_sock_t *sock, char *dst, const char *str, size_t len,
+                                uint8_t level, const char *tag, const char *fmt, va_list *va)
+{
+    size_t n = 0;
+
+    if (sock->format == XF_LOG_SOCK_FORMAT_RFC5424) {
+
+        // <PRI>1 TIMESTAMP HOSTNAME APP-NAME PROCID MSGID SD MSG
+        struct timespec ts;
+        struct tm tm;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        gmtime_r(&ts.tv_sec, &tm);
+        size_t tag_len = tag ? strlen(tag) : 0;
+        if (tag_len == 0 || tag_len > XF_LOG_SOCK_MSGID_MAX || strchr(tag, ' ') != NULL) {
+            tag = "-";
+            tag_len = 1;
+        }
+        int ret = snprintf(dst, XF_LOG_SOCK_MSG_SIZE, "<%u>1 %04d-%02d-%02dT%02d:%02d:%02d.%03ldZ %s %s %lu %.*s - ",
+                           sock->facility * 8U + s_lvl_to_severity[level <= XF_LOG_LVL_VERBOSE ? level : 0],
+                           tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                           ts.tv_nsec / 1000000L, sock->hostname, sock->app_name, (unsigned long)getpid(),
+                           (int)tag_len, tag);
+        n = (ret < 0) ? 0 : ((size_t)ret < XF_LOG_SOCK_MSG_SIZE ? (size_t)ret : XF_LOG_SOCK_MSG_SIZE - 1);
+
+        // 等级、tag 已经在头部，MSG 只放正文，不带颜色和位置信息
+        if (fmt != NULL && va != NULL) {
+            va_list args;
+            va_copy(args, *va);
+            size_t body = xf_log_vsnprintf(dst + n, XF_LOG_SOCK_MSG_SIZE - n, fmt, args);
+            va_end(args);
+            len = (body < XF_LOG_SOCK_MSG_SIZE - n) ? body : XF_LOG_SOCK_MSG_SIZE - n - 1;
+            str = dst + n;
+        }
+
+        // 数据报本身就是边界，去掉结尾的颜色复位和换行
+        for (;;) {
+            if (len >= sizeof(XF_LOG_SOCK_CSI_END) - 1
+                    && memcmp(str + len - (sizeof(XF_LOG_SOCK_CSI_END) - 1), XF_LOG_SOCK_CSI_END, sizeof(XF_LOG_SOCK_CSI_END) - 1) == 0) {
+                len -= sizeof(XF_LOG_SOCK_CSI_END) - 1;
+            } else if (len > 0 && (str[len - 1] == '\n' || str[len - 1] == '\r')) {
+                len--;
+            } else {
+                break;
+            }
+        }
+    }
+
+    if (len > XF_LOG_SOCK_MSG_SIZE - n) {
+        len = XF_LOG_SOCK_MSG_SIZE - n;
+    }
+    memmove(dst + n, str, len);
+
+    return n + len;
+}
+
+static void xf_log_sock_push(xf_log_sock_t *sock, const char *str, size_t len, uint8_t level, const char *tag,
+                             const char *fmt, va_list *va)
+{
+    // 批次已满时先尝试发送腾出空间，仍然满则按策略丢弃
+    if (sock->count >= XF_LOG_SOCK_BATCH_NUM) {
+        xf_log_sock_send(sock);
+    }
+    if (sock->count >= XF_LOG_SOCK_BATCH_NUM) {
+        uint32_t victim = 0;
+        if (sock->policy == XF_LOG_SOCK_DROP_BY_LEVEL) {
+            // 找批次中最旧的、等级低于新记录的一条，没有则丢弃新记录
+            for (victim = 0; victim < sock->count; victim++) {
+                if (XF_LOG_SOCK_RANK(sock->level[(sock->head + victim) % XF_LOG_SOCK_BATCH_NUM])
+                        > XF_LOG_SOCK_RANK(level)) {
+                    break;
+                }
+            }
+        }
+        if (sock->policy == XF_LOG_SOCK_DROP_NEWEST || victim >= sock->count) {
+            xf_log_atomic_add(&sock->dropped, 1);
+            sock->unreported++;
+            return;
+        }
+        // 比被挤掉的记录更旧的记录整体后移一格，保持批次内的先后顺序
+        for (; victim > 0; victim--) {
+            uint32_t dst = (sock->head + victim) % XF_LOG_SOCK_BATCH_NUM;
+            uint32_t src = (sock->head + victim - 1) % XF_LOG_SOCK_BATCH_NUM;
+            memcpy(sock->msg[dst], sock->msg[src], sock->len[src]);
+            sock->len[dst] = sock->len[src];
+            sock->level[dst] = sock->level[src];
+        }
+        sock->head = (sock->head + 1) % XF_LOG_SOCK_BATCH_NUM;
+        sock->count--;
+        xf_log_atomic_add(&sock->dropped, 1);
+        sock->unreported++;
+    }
+
+    uint32_t pos = (sock->head + sock->count) % XF_LOG_SOCK_BATCH_NUM;
+    sock->len[pos] = xf_log_sock_frame(sock, sock->msg[pos], str, len, level, tag, fmt, va);
+    sock->level[pos] = level;
+    if (sock->count == 0) {
+        sock->first_time = xf_log_sock_now();
+    }
+    sock->count++;
+}
+
+static size_t xf_log_sock_send(xf_log_sock_t *sock)
+{
+    struct mmsghdr msgs[XF_LOG_SOCK_BATCH_NUM];
+    struct iovec iov[XF_LOG_SOCK_BATCH_NUM];
+    uint32_t now = xf_log_sock_now();
+
+    // 接收端不在时按间隔重连，期间记录留在批次中
+    if (sock->fd < 0) {
+        if (now - sock->retry_time < XF_LOG_SOCK_RETRY_MS) {
+            return 0;
+        }
+        sock->retry_time = now;
+        if (xf_log_sock_connect(sock) < 0) {
+            return 0;
+        }
+    }
+
+    // 丢弃过记录时，在批次末尾补一条提示
+    if (sock->unreported && sock->count < XF_LOG_SOCK_BATCH_NUM) {
+        char text[64];
+        int n = snprintf(text, sizeof(text), "xf_log_sock: %lu records dropped\n", (unsigned long)sock->unreported);
+        uint32_t pos = (sock->head + sock->count) % XF_LOG_SOCK_BATCH_NUM;
+        sock->len[pos] = xf_log_sock_frame(sock, sock->msg[pos], text, n, XF_LOG_LVL_WARN, "xf_log",
+                                           NULL, NULL);
+        sock->level[pos] = XF_LOG_LVL_WARN;
+        sock->count++;
+        sock->unreported = 0;
+    }
+    if (sock->count == 0) {
+        return 0;
+    }
+
+    for (uint32_t k = 0; k < sock->count; k++) {
+        uint32_t pos = (sock->head + k) % XF_LOG_SOCK_BATCH_NUM;
+        iov[k].iov_base = sock->msg[pos];
+        iov[k].iov_len = sock->len[pos];
+        memset(&msgs[k], 0, sizeof(struct mmsghdr));
+        msgs[k].msg_hdr.msg_iov = &iov[k];
+        msgs[k].msg_hdr.msg_iovlen = 1;
+    }
+
+    int ret = sendmmsg(sock->fd, msgs, sock->count, MSG_DONTWAIT);
+    if (ret < 0) {
+        // 接收端来不及接收时保留记录，接收端已经不在则断开等待重连
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS && errno != EINTR) {
+            close(sock->fd);
+            sock->fd = -1;
+            sock->retry_time = now;
+        }
+        return 0;
+    }
+
+    sock->head = (sock->head + ret) % XF_LOG_SOCK_BATCH_NUM;
+    sock->count -= ret;
+    sock->first_time = now;
+
+    return ret;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file xf_log_backend_sock.h
+ * @author cangyu (sky.kirto@qq.com)
+ * @brief xf_log 本地套接字后端，按记录发送 Unix 数据报，可选 RFC 5424 syslog 格式。
+ * @version 0.1
+ * @date 2024-10-22
+ *
+ * @copyright Copyright (c) 2024, CorAL. All rights reserved.
+ *
+ */
+
+#ifndef __XF_LOG_BACKEND_SOCK_H__
+#define __XF_LOG_BACKEND_SOCK_H__
+
+/* ==================== [Includes] ========================================== */
+
+#include "xf_log.h"
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ==================== [Defines] =========================================== */
+
+// 一次 sendmmsg 最多发送的记录数，也是断开期间最多缓存的记录数
+#ifndef XF_LOG_SOCK_BATCH_NUM
+#define XF_LOG_SOCK_BATCH_NUM (16)
+#endif
+
+// 单个数据报的最大长度，超出部分会被截断
+#ifndef XF_LOG_SOCK_MSG_SIZE
+#define XF_LOG_SOCK_MSG_SIZE (512)
+#endif
+
+// 接收端不在时重新连接的间隔，单位 ms
+#ifndef XF_LOG_SOCK_RETRY_MS
+#define XF_LOG_SOCK_RETRY_MS (1000)
+#endif
+
+/* ==================== [Typedefs] ========================================== */
+
+/**
+ * @brief 数据报格式。
+ */
+typedef enum _xf_log_sock_format_t {
+    XF_LOG_SOCK_FORMAT_RAW = 0,         /*!< 原样发送格式化后的记录 */
+    XF_LOG_SOCK_FORMAT_RFC5424,         /*!< RFC 5424 syslog 格式，等级映射为 severity，MSG 只包含正文 */
+} xf_log_sock_format_t;
+
+/**
+ * @brief 批次已满（接收端不在或者来不及接收）时的丢弃策略。
+ */
+typedef enum _xf_log_sock_policy_t {
+    XF_LOG_SOCK_DROP_NEWEST = 0,        /*!< 丢弃新记录 */
+    XF_LOG_SOCK_DROP_OLDEST,            /*!< 丢弃最旧的记录 */
+    XF_LOG_SOCK_DROP_BY_LEVEL,          /*!< 新记录挤掉批次中最旧的、等级低于它的记录，没有时丢弃新记录 */
+} xf_log_sock_policy_t;
+
+/**
+ * @brief 本地套接字后端的句柄。
+ */
+typedef struct _xf_log_sock_t {
+    int fd;                             /*!< 套接字，未连接时为 -1 */
+    struct sockaddr_un addr;            /*!< 接收端地址 */
+    pthread_mutex_t lock;               /*!< 多个线程同时输出时保护批次 */
+    uint8_t format;                     /*!< 数据报格式，见 xf_log_sock_format_t */
+    uint8_t policy;                     /*!< 丢弃策略，见 xf_log_sock_policy_t */
+    uint8_t facility;                   /*!< syslog facility，默认 1 (user) */
+    const char *app_name;               /*!< syslog APP-NAME */
+    char hostname[64];                  /*!< syslog HOSTNAME */
+    uint32_t batch_num;                 /*!< 攒够多少条记录后发送 */
+    uint32_t latency;                   /*!< 最旧的记录最多等待多久发送，单位 ms */
+    uint32_t first_time;                /*!< 批次中最旧的记录进入的时间 */
+    uint32_t retry_time;                /*!< 上一次尝试连接的时间 */
+    uint32_t dropped;                   /*!< 累计丢弃的记录数 */
+    uint32_t unreported;                /*!< 还没有发出丢弃提示的记录数 */
+    uint32_t head;                      /*!< 批次中最旧的记录的位置 */
+    uint32_t count;                     /*!< 批次中的记录数 */
+    uint8_t level[XF_LOG_SOCK_BATCH_NUM];               /*!< 批次中各记录的等级 */
+    uint32_t len[XF_LOG_SOCK_BATCH_NUM];                /*!< 批次中各记录的长度 */
+    char msg[XF_LOG_SOCK_BATCH_NUM][XF_LOG_SOCK_MSG_SIZE]; /*!< 批次中各记录的内容 */
+} xf_log_sock_t;
+
+/* ==================== [Global Prototypes] ================================= */
+
+/**
+ * @brief 打开本地套接字后端，接收端不在时也会成功，之后自动重连
+ *
+ * @param sock 套接字后端句柄
+ * @param path 接收端的 Unix 数据报套接字路径，如 "/dev/log"
+ * @param format 数据报格式
+ * @return int  -1:失败, 0:成功
+ */
+int xf_log_sock_open(xf_log_sock_t *sock, const char *path, xf_log_sock_format_t format);
+
+/**
+ * @brief 关闭本地套接字后端，批次中剩余的记录会先尝试发送
+ *
+ * @param sock 套接字后端句柄
+ */
+void xf_log_sock_close(xf_log_sock_t *sock);
+
+/**
+ * @brief 设置批量发送的条件，满足任意一个即发送
+ *
+ * @param sock 套接字后端句柄
+ * @param num 攒够多少条记录后发送，不超过 XF_LOG_SOCK_BATCH_NUM，为 1 时每条记录立即发送
+ * @param latency 最旧的记录最多等待多久发送，单位 ms，需要周期调用 xf_log_sock_poll
+ */
+void xf_log_sock_set_batch(xf_log_sock_t *sock, uint32_t num, uint32_t latency);
+
+/**
+ * @brief 设置批次已满时的丢弃策略
+ *
+ * @param sock 套接字后端句柄
+ * @param policy 丢弃策略
+ */
+void xf_log_sock_set_policy(xf_log_sock_t *sock, xf_log_sock_policy_t policy);
+
+/**
+ * @brief 设置 RFC 5424 格式中的 facility 和 APP-NAME
+ *
+ * @param sock 套接字后端句柄
+ * @param facility syslog facility，0~23
+ * @param app_name 应用名，需要一直有效，不能包含空格
+ */
+void xf_log_sock_set_syslog(xf_log_sock_t *sock, uint8_t facility, const char *app_name);
+
+/**
+ * @brief 本地套接字后端的输出函数，参数为 xf_log_sock_t 句柄
+ *
+ * 每次调用作为一个数据报，需配合 xf_log_set_line_out_enable 使用。
+ *
+ * @param str 交由后端输出的字符串
+ * @param len 字符串的长度
+ * @param arg 套接字后端句柄
+ */
+void xf_log_sock_out(const char *str, size_t len, void *arg);
+
+/**
+ * @brief 检查批次是否超过等待时间以及是否需要重连，需要周期调用
+ *
+ * @param sock 套接字后端句柄
+ * @return size_t 发送的记录数
+ */
+size_t xf_log_sock_poll(xf_log_sock_t *sock);
+
+/**
+ * @brief 立即发送批次中的记录
+ *
+ * @param sock 套接字后端句柄
+ * @return size_t 发送的记录数
+ */
+size_t xf_log_sock_flush(xf_log_sock_t *sock);
+
+/**
+ * @brief 获取累计丢弃的记录数
+ *
+ * @param sock 套接字后端句柄
+ * @return uint32_t 累计丢弃的记录数
+ */
+uint32_t xf_log_sock_dropped(xf_log_sock_t *sock);
+
+/* ==================== [Macros] ============================================ */
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif // __XF_LOG_BACKEND_SOCK_H__
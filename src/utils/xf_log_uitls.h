@@ -58,6 +58,59 @@ extern "C" {
 #   define XF_LOGV(tag, format, ...)  (void)(tag)
 #endif
 
+#if XF_LOG_ISR_IS_ENABLE
+
+// 中断/信号上下文中使用，只记录调用点和参数，由 xf_log_isr_process 输出，最多 XF_LOG_ISR_ARG_NUM 个参数
+#if XF_LOG_LEVEL >= XF_LOG_LVL_USER
+#   define XF_LOGU_ISR(tag, format, ...)  xf_log_isr_level(XF_LOG_LVL_USER, tag, format, ##__VA_ARGS__)
+#else
+#   define XF_LOGU_ISR(tag, format, ...)  (void)(tag)
+#endif
+
+#if XF_LOG_LEVEL >= XF_LOG_LVL_ERROR
+#   define XF_LOGE_ISR(tag, format, ...)  xf_log_isr_level(XF_LOG_LVL_ERROR, tag, format, ##__VA_ARGS__)
+#else
+#   define XF_LOGE_ISR(tag, format, ...)  (void)(tag)
+#endif
+
+#if XF_LOG_LEVEL >= XF_LOG_LVL_WARN
+#   define XF_LOGW_ISR(tag, format, ...)  xf_log_isr_level(XF_LOG_LVL_WARN, tag, format, ##__VA_ARGS__)
+#else
+#   define XF_LOGW_ISR(tag, format, ...)  (void)(tag)
+#endif
+
+#if XF_LOG_LEVEL >= XF_LOG_LVL_INFO
+#   define XF_LOGI_ISR(tag, format, ...)  xf_log_isr_level(XF_LOG_LVL_INFO, tag, format, ##__VA_ARGS__)
+#else
+#   define XF_LOGI_ISR(tag, format, ...)  (void)(tag)
+#endif
+
+#if XF_LOG_LEVEL >= XF_LOG_LVL_DEBUG
+#   define XF_LOGD_ISR(tag, format, ...)  xf_log_isr_level(XF_LOG_LVL_DEBUG, tag, format, ##__VA_ARGS__)
+#else
+#   define XF_LOGD_ISR(tag, format, ...)  (void)(tag)
+#endif
+
+#if XF_LOG_LEVEL >= XF_LOG_LVL_VERBOSE
+#   define XF_LOGV_ISR(tag, format, ...)  xf_log_isr_level(XF_LOG_LVL_VERBOSE, tag, format, ##__VA_ARGS__)
+#else
+#   define XF_LOGV_ISR(tag, format, ...)  (void)(tag)
+#endif
+
+#endif
+
+#if XF_LOG_HEX_IS_ENABLE
+
+// 输出二进制缓冲区，等级高于 XF_LOG_LEVEL 时在编译期移除，高于运行时等级时跳过
+#define XF_LOG_BUFFER_HEX(level, tag, buf, len)                                                     \
+    ((level) <= XF_LOG_LEVEL && XF_LOG_GATE(level)                                                  \
+     ? xf_log_buffer_hex(level, tag, XF_LOG_FILE, __LINE__, __func__, buf, len) : 0)
+#define XF_LOG_BUFFER_HEXDUMP(level, tag, buf, len)                                                 \
+    ((level) <= XF_LOG_LEVEL && XF_LOG_GATE(level)                                                  \
+     ? xf_log_buffer_hexdump(level, tag, XF_LOG_FILE, __LINE__, __func__, buf, len) : 0)
+
+#endif
+
 /* ==================== [Typedefs] ========================================== */
 
 /* ==================== [Global Prototypes] ================================= */
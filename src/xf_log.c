@@ -19,6 +19,9 @@
 #define PL_CSI_START                "\033["
 #define PL_CSI_END                  "\033[0m"
 
+// 二进制缓冲区输出一行的最大长度：偏移、十六进制栏、ASCII 栏以及分隔符
+#define XF_LOG_HEX_TEXT_SIZE        (4 * XF_LOG_HEX_LINE_WIDTH + XF_LOG_HEX_LINE_WIDTH / 8 + 16)
+
 #if XF_LOG_CTYPE_IS_ENABLE
 #include <ctype.h>
 #else
@@ -51,6 +54,27 @@ typedef enum _xf_log_color_t {
     XF_LOG_COLOR_MAX,
 } xf_log_color_t;
 
+typedef enum _xf_log_spec_type_t {
+    XF_LOG_SPEC_TEXT = 0,   // 原样输出的文本，%% 也按文本输出
+    XF_LOG_SPEC_STR,        // %s，可带宽度和精度，直接输出
+    XF_LOG_SPEC_CONV,       // 其余格式控制符，交给 xf_log_vsprintf
+} xf_log_spec_type_t;
+
+typedef enum _xf_log_arg_t {
+    XF_LOG_ARG_NONE = 0,
+    XF_LOG_ARG_INT,         // 含 char、short 以及 %c，按 int 提升
+    XF_LOG_ARG_LONG,
+    XF_LOG_ARG_LLONG,       // 含 intmax_t
+    XF_LOG_ARG_SIZE,        // 含 ptrdiff_t
+    XF_LOG_ARG_DOUBLE,      // 含 float，按 double 提升
+    XF_LOG_ARG_LDOUBLE,
+    XF_LOG_ARG_PTR,
+
+    XF_LOG_ARG_TYPE_MASK = 0x0F,
+} xf_log_arg_t;
+
+#define XF_LOG_ARG_STAR_SHIFT   (4)     // 宽度和精度中 '*' 的个数记录在 arg 的高 4 位
+
 #if XF_LOG_FILTER_IS_ENABLE
 
 typedef struct _xf_log_filter_t {
@@ -62,10 +86,116 @@ typedef struct _xf_log_filter_t {
     const char *file;
 } xf_log_filter_t;
 
+typedef enum _xf_log_filter_reason_t {
+    XF_LOG_FILTER_NONE = 0,
+    XF_LOG_FILTER_LEVEL,
+    XF_LOG_FILTER_TAG,
+    XF_LOG_FILTER_FILE,
+} xf_log_filter_reason_t;
+
+#endif
+
+#if XF_LOG_LAYOUT_IS_ENABLE
+
+typedef enum _xf_log_layout_op_type_t {
+    XF_LOG_LAYOUT_OP_TEXT = 0,  // 原样输出格式字符串中的一段文本
+    XF_LOG_LAYOUT_OP_TIME,
+    XF_LOG_LAYOUT_OP_LEVEL,
+    XF_LOG_LAYOUT_OP_TAG,
+    XF_LOG_LAYOUT_OP_FILE,
+    XF_LOG_LAYOUT_OP_LINE,
+    XF_LOG_LAYOUT_OP_FUNC,
+    XF_LOG_LAYOUT_OP_MSG,
+    XF_LOG_LAYOUT_OP_COLOR,
+    XF_LOG_LAYOUT_OP_RESET,
+    XF_LOG_LAYOUT_OP_INFO,      // 等级不满足 info_level 时跳过之后的 len 个操作
+} xf_log_layout_op_type_t;
+
+typedef struct _xf_log_layout_op_t {
+    uint8_t type;
+    uint8_t pos;            // 文本在格式字符串中的偏移
+    uint8_t len;            // 文本长度，或者条件组包含的操作数
+} xf_log_layout_op_t;
+
+typedef struct _xf_log_layout_t {
+    const char *pattern;    // 为 NULL 时使用默认格式
+    uint8_t num;
+    xf_log_layout_op_t op[XF_LOG_LAYOUT_OP_NUM];
+} xf_log_layout_t;
+
+#endif
+
+#if XF_LOG_ASYNC_IS_ENABLE
+
+typedef struct _xf_log_record_t {
+    uint32_t ref;           // 引用计数，为 0 表示空闲
+    uint32_t time;
+    uint32_t line;
+    uint32_t len;
+    const char *tag;
+    const char *file;
+    const char *func;
+    uint8_t level;          // XF_LOG_LVL_NONE 表示来自 xf_log_printf，原样输出
+    char body[XF_LOG_RECORD_SIZE];  // 格式化后的用户日志，由所有异步后端共享
+} xf_log_record_t;
+
+typedef struct _xf_log_queue_t {
+    xf_log_record_t *slot[XF_LOG_QUEUE_SIZE];
+    uint32_t head;          // 写入位置，只增不减，取模后得到实际位置
+    uint32_t tail;          // 读取位置
+    uint32_t timeout;       // 阻塞等待的超时时间，单位与时间戳函数一致
+    uint32_t dropped;       // 尚未报告的丢弃记录数
+    uint32_t drop_pos;      // 丢弃发生的位置，排空到此处时输出丢弃提示
+    xf_log_notify_t notify;
+    void *notify_args;
+    uint8_t enable;
+    uint8_t policy;
+    uint8_t lock;
+    uint8_t draining;
+} xf_log_queue_t;
+
+#endif
+
+#if XF_LOG_SHARD_IS_ENABLE
+
+#if XF_LOG_SHARD_SLOT_NUM & (XF_LOG_SHARD_SLOT_NUM - 1)
+#error "XF_LOG_SHARD_SLOT_NUM must be a power of 2"
+#endif
+
+#if XF_LOG_OBJ_NUM > 32
+#error "XF_LOG_SHARD_ENABLE supports at most 32 log objects"
+#endif
+
+typedef struct _xf_log_shard_record_t {
+    uint32_t stamp;         // 合并排序用的时间戳，提交前取得
+    uint32_t time;
+    uint32_t mask;          // 需要输出到的后端，按 id 置位
+    uint32_t line;
+    uint32_t len;
+    const char *tag;
+    const char *file;
+    const char *func;
+    uint8_t level;          // XF_LOG_LVL_NONE 表示来自 xf_log_printf，原样输出
+    char body[XF_LOG_RECORD_SIZE];
+} xf_log_shard_record_t;
+
+typedef struct _xf_log_shard_t {
+    uint32_t head;          // 写入位置，只由持有 lock 的生产者修改
+    uint32_t dropped;       // 分片满时丢弃的记录数
+    uint8_t lock;           // 线程数不超过分片数时只有一个生产者，不会竞争
+    char pad[XF_LOG_CACHE_LINE];
+    uint32_t tail;          // 读取位置，只由合并者修改，与 head 分处不同的缓存行
+    char pad_tail[XF_LOG_CACHE_LINE];
+    xf_log_shard_record_t slot[XF_LOG_SHARD_SLOT_NUM];
+} xf_log_shard_t;
+
 #endif
 
 typedef struct _xf_log_obj_t {
     uint8_t info_level;
+#if XF_LOG_LINE_OUT_IS_ENABLE
+    uint8_t line_out;       // 整条记录格式化完成后一次交给 out_func
+#endif
     xf_log_out_t out_func;
     void *user_args;
 
@@ -75,13 +205,175 @@ typedef struct _xf_log_obj_t {
 
 #endif
 
+#if XF_LOG_LAYOUT_IS_ENABLE
+
+    // 开启注销功能时使用两份格式交替发布，输出只读取 layout_cur 指向的一份
+    xf_log_layout_t layout[XF_LOG_DYNAMIC_IS_ENABLE + 1];
+    uint8_t layout_cur;
+
+#endif
+
+#if XF_LOG_ASYNC_IS_ENABLE
+
+    xf_log_queue_t queue;
+
+#endif
+
+#if XF_LOG_SHARD_IS_ENABLE
+
+    uint8_t shard;          // 记录写入线程所在的分片，合并时输出
+
+#endif
+
 } xf_log_obj_t;
 
+#if XF_LOG_ISR_IS_ENABLE
+
+#if XF_LOG_ISR_SLOT_NUM & (XF_LOG_ISR_SLOT_NUM - 1)
+#error "XF_LOG_ISR_SLOT_NUM must be a power of 2"
+#endif
+
+#define XF_LOG_ISR_LAP(pos) ((pos) & ~(uint32_t)(XF_LOG_ISR_SLOT_NUM - 1))
+
+typedef union _xf_log_isr_arg_t {
+    long long i;            // 各种整数，按 xf_log_arg_t 还原为原类型
+    double d;
+    long double ld;
+    const void *p;
+} xf_log_isr_arg_t;
+
+typedef struct _xf_log_isr_slot_t {
+    uint32_t seq;           // 减去槽位下标后的序号，等于 LAP 表示空闲可写，等于 LAP + 1 表示已提交，零初始化即可用
+    uint8_t num;
+    const xf_log_isr_site_t *site;
+    const char *tag;
+    uint8_t type[XF_LOG_ISR_ARG_NUM];   // 各参数的 xf_log_arg_t
+    xf_log_isr_arg_t args[XF_LOG_ISR_ARG_NUM];
+} xf_log_isr_slot_t;
+
+#endif
+
+#if XF_LOG_OBJ_NUM > 256
+#error "XF_LOG_OBJ_NUM supports at most 256 log objects, active ids are stored as uint8_t"
+#endif
+
+typedef struct _xf_log_active_t {
+    uint32_t num;
+    uint8_t id[XF_LOG_OBJ_NUM];     // 已注册的log对象id，按注册顺序排列
+} xf_log_active_t;
+
 /* ==================== [Static Prototypes] ================================= */
 
+#if XF_LOG_FILTER_IS_ENABLE
+static uint8_t xf_log_filter_reason(size_t log_obj_id, uint8_t level, const char *tag, const char *file);
+#endif
+
+static size_t xf_log_va(uint8_t level, const char *tag, const char *file, uint32_t line, const char *func,
+                        const char *fmt, va_list va, size_t *emitted);
 static size_t xf_log_vprintf(xf_log_out_t log_out, void *arg, const char *format, va_list va);
-static size_t xf_log_color_format(int log_obj_id, uint8_t level, const char *tag, const char *file, uint32_t line,
+static size_t xf_log_spec_parse(const char *p, xf_log_spec_t *spec);
+static void xf_log_arg_skip(va_list *va, uint8_t arg);
+#if XF_LOG_ISR_IS_ENABLE
+static void xf_log_isr_arg_read(xf_log_isr_arg_t *a, uint8_t type, va_list *va);
+static int xf_log_isr_sprintf(char *buffer, size_t maxlen, const char *fmt, ...);
+static int xf_log_isr_conv(char *buffer, size_t maxlen, const char *flag, const xf_log_isr_arg_t *a,
+                           const uint8_t *type, uint8_t star);
+static size_t xf_log_isr_render(char *buffer, size_t size, const char *fmt, const xf_log_isr_arg_t *a,
+                                const uint8_t *type, uint8_t num);
+#endif
+static size_t xf_log_spec_str(xf_log_out_t log_out, void *arg, const char *start, size_t len, va_list *va);
+static size_t xf_log_spec_out(xf_log_out_t log_out, void *arg, const char *start, const xf_log_spec_t *spec,
+                              va_list *va);
+static size_t xf_log_color_format(int log_obj_id, xf_log_out_t out_func, void *user_args, uint8_t level,
+                                  uint32_t time, const char *tag, const char *file, uint32_t line,
                                   const char *func, const char *fmt, va_list va);
+#if !XF_LOG_LAYOUT_IS_ENABLE || XF_LOG_STATIC_IS_ENABLE
+static size_t xf_log_record_format(xf_log_out_t out_func, void *user_args, uint8_t info, uint8_t colorful,
+                                   uint8_t level, uint32_t time, const char *tag, const char *file, uint32_t line,
+                                   const char *func, const char *fmt, va_list va);
+#endif
+static size_t xf_log_obj_format(int log_obj_id, uint8_t level, uint32_t time, const char *tag, const char *file,
+                                uint32_t line, const char *func, const char *fmt, va_list va);
+static size_t xf_log_obj_vprintf(int log_obj_id, const char *format, va_list va);
+#if XF_LOG_STATIC_IS_ENABLE
+static size_t xf_log_static_format(uint8_t level, uint32_t time, const char *tag, const char *file, uint32_t line,
+                                   const char *func, const char *fmt, va_list va, size_t *count);
+static size_t xf_log_static_vprintf(const char *format, va_list va);
+static int xf_log_static_match(const char *expect, const char *str);
+#endif
+
+static void xf_log_buf_out(const char *str, size_t len, void *arg);
+#if XF_LOG_ASYNC_IS_ENABLE || XF_LOG_LINE_OUT_IS_ENABLE || XF_LOG_SHARD_IS_ENABLE || XF_LOG_STATIC_IS_ENABLE
+static size_t xf_log_buf_end(xf_log_cursor_t *buf, uint8_t newline);
+#endif
+
+#if XF_LOG_DYNAMIC_IS_ENABLE
+static uint32_t *xf_log_read_lock(void);
+static void xf_log_synchronize(void);
+static void xf_log_active_publish(size_t log_obj_id, uint8_t add);
+#endif
+
+#if XF_LOG_ASYNC_IS_ENABLE || XF_LOG_DYNAMIC_IS_ENABLE || XF_LOG_SHARD_IS_ENABLE
+static void xf_log_spin_lock(uint8_t *lock);
+static void xf_log_spin_unlock(uint8_t *lock);
+#endif
+
+#if XF_LOG_HEX_IS_ENABLE
+static int xf_log_is_enabled(uint8_t level, const char *tag, const char *file);
+static size_t xf_log_buffer_out(uint8_t level, const char *tag, const char *file, uint32_t line, const char *func,
+                                const uint8_t *data, size_t len, uint8_t dump);
+#endif
+
+#if XF_LOG_STATS_IS_ENABLE || XF_LOG_LAYOUT_IS_ENABLE
+static size_t xf_log_utoa(char *buf, uint32_t val);
+#endif
+
+#if XF_LOG_LAYOUT_IS_ENABLE
+static int xf_log_layout_compile(xf_log_layout_t *layout, const char *pattern);
+static size_t xf_log_layout_format(int log_obj_id, xf_log_out_t out_func, void *user_args, uint8_t level,
+                                   uint32_t time, const char *tag, const char *file, uint32_t line,
+                                   const char *func, const char *fmt, va_list va);
+#endif
+
+#if XF_LOG_STATS_IS_ENABLE
+static xf_log_stats_t *xf_log_stats_get(int log_obj_id);
+static void xf_log_obj_out(const char *str, size_t len, void *arg);
+static void xf_log_stats_dump_one(const char *name, int log_obj_id);
+static void xf_log_stats_poll(void);
+#endif
+
+#if XF_LOG_ASYNC_IS_ENABLE || XF_LOG_SHARD_IS_ENABLE
+static size_t xf_log_obj_printf(int log_obj_id, uint8_t level, uint32_t time, const char *tag, const char *file,
+                                uint32_t line, const char *func, const char *fmt, ...);
+#endif
+
+#if XF_LOG_ASYNC_IS_ENABLE
+static xf_log_record_t *xf_log_record_create(uint8_t level, uint32_t time, const char *tag, const char *file,
+                                             uint32_t line, const char *func, const char *fmt, va_list va);
+static void xf_log_record_release(xf_log_record_t *record);
+static int xf_log_queue_push(int log_obj_id, xf_log_record_t *record);
+static size_t xf_log_queue_drain(int log_obj_id);
+#endif
+
+#if XF_LOG_SHARD_IS_ENABLE
+static uint32_t xf_log_shard_now(void);
+static int xf_log_shard_push(uint32_t mask, uint8_t level, uint32_t time, const char *tag, const char *file,
+                             uint32_t line, const char *func, const char *fmt, va_list va, size_t *len);
+static void xf_log_shard_out(const xf_log_shard_record_t *record);
+static uint8_t xf_log_shard_lock(uint8_t wait);
+static size_t xf_log_shard_merge(uint8_t flush);
+static void xf_log_shard_stop(size_t log_obj_id, uint8_t forget);
+#endif
+
+#if XF_LOG_CALLSITE_IS_ENABLE
+static void xf_log_callsite_register(xf_log_callsite_t *callsite, const char *tag);
+static void xf_log_callsite_poll(void);
+#endif
+
+#if XF_LOG_BUDGET_IS_ENABLE
+static void xf_log_budget_poll(void);
+static void xf_log_budget_step(uint8_t level, uint32_t bytes, uint32_t records, uint32_t elapsed);
+#endif
 
 /* ==================== [Static Variables] ================================== */
 
@@ -107,16 +399,158 @@ static const uint8_t s_lvl_to_color[] = {
 };
 #endif
 
+#if XF_LOG_LAYOUT_IS_ENABLE
+// 各等级颜色的转义序列，输出时直接写出
+static const char *const s_lvl_to_csi[] = {
+    "",
+    PL_CSI_START "0;34m",
+    PL_CSI_START "0;31m",
+    PL_CSI_START "0;33m",
+    PL_CSI_START "0;32m",
+    PL_CSI_START "0;36m",
+    "",
+};
+
+// 默认格式，分别对应未设置和已设置时间戳函数
+static const char *const s_log_layout_pattern[] = {
+    "%C%L %t%[[%f:%l(%F)]%]: %m%R",
+    "%C%L (%T)-%t%[[%f:%l(%F)]%]: %m%R",
+};
+static xf_log_layout_t s_log_layout_default[2] = {0};
+#endif
+
 static xf_log_obj_t s_log_obj[XF_LOG_OBJ_NUM] = {0};
 
+// 输出时只遍历活动列表，开启注销功能时使用两份列表交替发布
+static xf_log_active_t s_log_active[XF_LOG_DYNAMIC_IS_ENABLE + 1] = {0};
+
+#if XF_LOG_DYNAMIC_IS_ENABLE
+static xf_log_active_t *s_log_active_cur = &s_log_active[0];
+static uint32_t s_log_epoch = 0;
+static uint32_t s_log_epoch_readers[2][XF_LOG_EPOCH_SHARD_NUM] = {0};
+static uint8_t s_log_epoch_shard_next = 0;
+static uint8_t s_log_obj_lock = 0;
+#endif
+
 static xf_log_time_func_t s_log_time_func = NULL;
 
+static xf_log_tick_func_t s_log_tick_func = NULL;
+
+#if XF_LOG_STATS_IS_ENABLE
+static xf_log_stats_t s_log_stats[XF_LOG_STATS_SHARD_NUM][XF_LOG_OBJ_NUM] = {0};
+#if XF_LOG_STATS_SHARD_NUM > 1
+static uint8_t s_log_stats_shard_next = 0;
+#endif
+static uint32_t s_log_stats_period = 0;
+static uint32_t s_log_stats_last = 0;
+#endif
+
+#if XF_LOG_ASYNC_IS_ENABLE
+static xf_log_record_t s_log_record[XF_LOG_RECORD_NUM] = {0};
+static uint32_t s_log_record_hint = 0;
+#endif
+
+#if XF_LOG_SHARD_IS_ENABLE
+static xf_log_shard_t s_log_shard[XF_LOG_SHARD_NUM] = {0};
+static uint8_t s_log_shard_next = 0;
+static uint8_t s_log_shard_merging = 0;
+static uint32_t s_log_shard_window = 0;
+static uint32_t s_log_shard_reported = 0;
+#endif
+
+#if XF_LOG_LINE_OUT_IS_ENABLE
+static XF_LOG_THREAD_LOCAL const xf_log_line_info_t *s_log_line_info = NULL;
+#endif
+
+#if XF_LOG_CALLSITE_IS_ENABLE
+static XF_LOG_THREAD_LOCAL const xf_log_callsite_t *s_log_callsite_cur = NULL;
+static xf_log_callsite_t *s_log_callsite_head = NULL;
+static uint8_t s_log_callsite_dump_pending = 0;
+static uint32_t s_log_callsite_window_time = 0;     // 报告窗口开始的时间
+static uint8_t s_log_callsite_window_valid = 0;     // 窗口开始时是否已经设置时间戳函数
+#endif
+
+#if XF_LOG_ISR_IS_ENABLE
+static xf_log_isr_slot_t s_log_isr_slot[XF_LOG_ISR_SLOT_NUM] = {0};
+static uint32_t s_log_isr_head = 0;
+static uint32_t s_log_isr_tail = 0;
+static uint32_t s_log_isr_dropped = 0;
+static uint32_t s_log_isr_reported = 0;
+#endif
+
+#if XF_LOG_BUDGET_IS_ENABLE
+uint8_t xf_log_gate_level = XF_LOG_LVL_VERBOSE;
+static uint8_t s_log_budget_level = XF_LOG_LVL_VERBOSE;
+static uint32_t s_log_budget_bytes_limit = 0;
+static uint32_t s_log_budget_records_limit = 0;
+static uint32_t s_log_budget_period = 0;
+static uint32_t s_log_budget_last = 0;
+static uint32_t s_log_budget_bytes = 0;
+static uint32_t s_log_budget_records = 0;
+static uint32_t s_log_budget_bytes_base = 0;
+static uint32_t s_log_budget_records_base = 0;
+static uint32_t s_log_budget_calm = 0;
+static uint32_t s_log_budget_hold = XF_LOG_BUDGET_HOLD_NUM;
+static uint8_t s_log_budget_restored = 0;     // 上次超出预算之后是否恢复过等级
+#endif
+
+#if XF_LOG_HEX_IS_ENABLE
+static const char s_hex_digits[] = "0123456789abcdef";
+#endif
+
 /* ==================== [Macros] ============================================ */
 
+#if XF_LOG_STATIC_IS_ENABLE
+// 静态后端的输出函数由这里统一声明，xf_log_config.h 中只需要列出
+#define XF_LOG_STATIC_DECLARE(out_func, user_args, level, info_level, colorful, tag, file) \
+    void out_func(const char *str, size_t len, void *arg);
+XF_LOG_STATIC_OBJS(XF_LOG_STATIC_DECLARE)
+#undef XF_LOG_STATIC_DECLARE
+
+// 静态后端是否接收这条记录，过滤值都是常量，为 NULL 的条件在编译期消去
+#define XF_LOG_STATIC_ACCEPT(max_level, tag_filter, file_filter, level, tag, file)   \
+    ((level) <= (max_level)                                                         \
+     && ((tag_filter) == NULL || xf_log_static_match((tag_filter), (tag)))          \
+     && ((file_filter) == NULL || xf_log_static_match((file_filter), (file))))
+#endif
+
+#if XF_LOG_DYNAMIC_IS_ENABLE
+#define XF_LOG_READ_LOCK(epoch)     uint32_t *epoch = xf_log_read_lock()
+#define XF_LOG_READ_UNLOCK(epoch)   xf_log_atomic_sub(epoch, 1)
+#define XF_LOG_ACTIVE()             ((const xf_log_active_t *)xf_log_atomic_load_acquire(&s_log_active_cur))
+#else
+#define XF_LOG_READ_LOCK(epoch)
+#define XF_LOG_READ_UNLOCK(epoch)
+#define XF_LOG_ACTIVE()             ((const xf_log_active_t *)&s_log_active[0])
+#endif
+
+#if XF_LOG_STATS_IS_ENABLE
+#define XF_LOG_STATS_ADD(log_obj_id, member, val) xf_log_atomic_add(&xf_log_stats_get(log_obj_id)->member, (val))
+#define XF_LOG_OBJ_OUT_FUNC(log_obj_id)     xf_log_obj_out
+#define XF_LOG_OBJ_OUT_ARGS(log_obj_id)     (&s_log_obj[log_obj_id])
+#else
+#define XF_LOG_STATS_ADD(log_obj_id, member, val)
+#define XF_LOG_OBJ_OUT_FUNC(log_obj_id)     (s_log_obj[log_obj_id].out_func)
+#define XF_LOG_OBJ_OUT_ARGS(log_obj_id)     (s_log_obj[log_obj_id].user_args)
+#endif
+
+#if XF_LOG_BUDGET_IS_ENABLE
+// 按交给后端的实际字节数计费，异步和分片的记录在取出输出时计费
+#define XF_LOG_BUDGET_CHARGE(bytes)         xf_log_atomic_add(&s_log_budget_bytes, (uint32_t)(bytes))
+#else
+#define XF_LOG_BUDGET_CHARGE(bytes)
+#endif
+
 /* ==================== [Global Functions] ================================== */
 
 int xf_log_register_obj(xf_log_out_t out_func, void *user_args)
 {
+    int log_obj_id = -1;
+
+#if XF_LOG_DYNAMIC_IS_ENABLE
+    xf_log_spin_lock(&s_log_obj_lock);
+#endif
+
     for (size_t i = 0; i < XF_LOG_OBJ_NUM; i++) {
         if (s_log_obj[i].out_func != NULL) {
             continue;
@@ -124,6 +558,9 @@ int xf_log_register_obj(xf_log_out_t out_func, void *user_args)
         s_log_obj[i].out_func = out_func;
         s_log_obj[i].user_args = user_args;
         s_log_obj[i].info_level = XF_LOG_LVL_ERROR;     // 当log等级大于等于XF_LOG_LVL_ERROR时才会输出相关信息
+#if XF_LOG_LINE_OUT_IS_ENABLE
+        s_log_obj[i].line_out = 0;                      // 默认分段输出，不占用栈上的行缓冲
+#endif
 
 #if XF_LOG_FILTER_IS_ENABLE
 
@@ -135,12 +572,103 @@ int xf_log_register_obj(xf_log_out_t out_func, void *user_args)
         s_log_obj[i].filter.file = NULL;                // 不对 file 进行任何屏蔽
 
 #endif
-        return i;
+
+#if XF_LOG_LAYOUT_IS_ENABLE
+
+        s_log_obj[i].layout_cur = 0;
+        s_log_obj[i].layout[0].pattern = NULL;          // 使用默认格式
+        if (s_log_layout_default[0].pattern == NULL) {
+            xf_log_layout_compile(&s_log_layout_default[0], s_log_layout_pattern[0]);
+            xf_log_layout_compile(&s_log_layout_default[1], s_log_layout_pattern[1]);
+        }
+
+#endif
+
+#if XF_LOG_ASYNC_IS_ENABLE
+
+        s_log_obj[i].queue.enable = 0;                  // 默认在调用者上下文中直接输出
+        s_log_obj[i].queue.notify = NULL;
+
+#endif
+
+#if XF_LOG_SHARD_IS_ENABLE
+
+        s_log_obj[i].shard = 0;                         // 默认在调用者上下文中直接输出
+
+#endif
+
+#if XF_LOG_STATS_IS_ENABLE
+
+        // id 可能被复用，统计从零开始
+        for (size_t s = 0; s < XF_LOG_STATS_SHARD_NUM; s++) {
+            s_log_stats[s][i] = (xf_log_stats_t) {0};
+        }
+
+#endif
+
+        // 加入活动列表后才会被输出
+#if XF_LOG_DYNAMIC_IS_ENABLE
+        xf_log_active_publish(i, 1);
+#else
+        s_log_active[0].id[s_log_active[0].num++] = i;
+#endif
+        log_obj_id = i;
+        break;
     }
 
-    return -1;
+#if XF_LOG_DYNAMIC_IS_ENABLE
+    xf_log_spin_unlock(&s_log_obj_lock);
+#endif
+
+    return log_obj_id;
+}
+
+#if XF_LOG_DYNAMIC_IS_ENABLE
+
+int xf_log_unregister_obj(int log_obj_id)
+{
+    if (log_obj_id < 0 || log_obj_id >= XF_LOG_OBJ_NUM) {
+        return -1;
+    }
+
+    xf_log_spin_lock(&s_log_obj_lock);
+    if (s_log_obj[log_obj_id].out_func == NULL) {
+        xf_log_spin_unlock(&s_log_obj_lock);
+        return -1;
+    }
+
+#if XF_LOG_ASYNC_IS_ENABLE
+    // 先停止入队，阻塞等待的生产者会放弃等待，避免宽限期无法结束
+    xf_log_queue_t *q = &s_log_obj[log_obj_id].queue;
+    xf_log_spin_lock(&q->lock);
+    xf_log_atomic_store_release(&q->enable, 0);
+    xf_log_spin_unlock(&q->lock);
+#endif
+
+#if XF_LOG_SHARD_IS_ENABLE
+    // 分片中已有的记录在移除前输出，之后该 id 的记录不再写入分片，id 被复用时不会收到旧记录
+    if (s_log_obj[log_obj_id].shard) {
+        xf_log_shard_stop(log_obj_id, 1);
+    }
+#endif
+
+    // 从活动列表中移除，返回时所有可能看到该后端的调用（包括 xf_log_flush）都已结束
+    xf_log_active_publish(log_obj_id, 0);
+
+#if XF_LOG_ASYNC_IS_ENABLE
+    // 此时没有其他上下文访问该队列，剩余的记录直接输出并释放
+    xf_log_queue_drain(log_obj_id);
+#endif
+
+    s_log_obj[log_obj_id].out_func = NULL;
+    s_log_obj[log_obj_id].user_args = NULL;
+    xf_log_spin_unlock(&s_log_obj_lock);
+
+    return 0;
 }
 
+#endif
+
 #if XF_LOG_FILTER_IS_ENABLE
 
 void xf_log_set_filter_enable(int log_obj_id)
@@ -195,313 +723,2469 @@ void xf_log_set_info_level(int log_obj_id, uint8_t level)
     s_log_obj[log_obj_id].info_level = level;
 }
 
-void xf_log_set_time_func(xf_log_time_func_t log_time_func)
-{
-    s_log_time_func = log_time_func;
-}
+#if XF_LOG_LAYOUT_IS_ENABLE
 
-size_t xf_log(uint8_t level, const char *tag, const char *file, uint32_t line, const char *func, const char *fmt, ...)
+int xf_log_set_layout(int log_obj_id, const char *pattern)
 {
-    size_t len = 0;
-    // 根据不同的订阅进行不同的输出
-    va_list args;
-    va_start(args, fmt);
-    for (size_t i = 0; i < XF_LOG_OBJ_NUM; i++) {
-        if (s_log_obj[i].out_func == NULL) {
-            continue;
-        }
-#if XF_LOG_FILTER_IS_ENABLE
-        // 根据屏蔽等级判断后续是否执行
-        xf_log_filter_t filter = s_log_obj[i].filter;
-        if (filter.enable) {
-            if (filter.b_or_w == 0) {
-                if (filter.level < level) {
-                    continue;
-                } else if (filter.tag != NULL && filter.tag == tag) {
-                    continue;
-                } else if (filter.file != NULL && filter.file == file) {
-                    continue;
-                }
+    xf_log_layout_t layout = {0};
 
-            } else if (filter.b_or_w == 1) {
-                if (filter.level < level) {
-                    continue;
-                } else if (filter.tag != NULL && filter.tag != tag) {
-                    continue;
-                } else if (filter.file != NULL && filter.file != file) {
-                    continue;
-                }
-            }
-        }
-#endif
-        len = xf_log_color_format(i, level, tag, file, line, func, fmt, args);
+    if (log_obj_id < 0 || log_obj_id >= XF_LOG_OBJ_NUM) {
+        return -1;
+    }
+    if (pattern != NULL && xf_log_layout_compile(&layout, pattern) < 0) {
+        return -1;
     }
-    va_end(args);
 
-    return len;
+#if XF_LOG_DYNAMIC_IS_ENABLE
+    // 写入读者不使用的另一份再整体发布，等待仍在使用旧格式的输出结束后才能被下一次设置复用
+    xf_log_spin_lock(&s_log_obj_lock);
+    uint8_t next = !s_log_obj[log_obj_id].layout_cur;
+    s_log_obj[log_obj_id].layout[next] = layout;
+    xf_log_atomic_store_release(&s_log_obj[log_obj_id].layout_cur, next);
+    xf_log_synchronize();
+    xf_log_spin_unlock(&s_log_obj_lock);
+#else
+    s_log_obj[log_obj_id].layout[0] = layout;
+#endif
+
+    return 0;
 }
 
-size_t xf_log_printf(const char *format, ...)
+#endif
+
+#if XF_LOG_LINE_OUT_IS_ENABLE
+
+void xf_log_set_line_out_enable(int log_obj_id)
 {
-    size_t len = 0;
-    va_list args;
-    va_start(args, format);
-    for (size_t i = 0; i < XF_LOG_OBJ_NUM; i++) {
-        if (s_log_obj[i].out_func == NULL) {
-            continue;
-        }
-        len = xf_log_vprintf(s_log_obj[i].out_func, s_log_obj[i].user_args, format, args);
-    }
-    va_end(args);
+    s_log_obj[log_obj_id].line_out = 1;
+}
 
-    return len;
+void xf_log_set_line_out_disable(int log_obj_id)
+{
+    s_log_obj[log_obj_id].line_out = 0;
 }
 
-/* ==================== [Static Functions] ================================== */
+const xf_log_line_info_t *xf_log_get_line_info(void)
+{
+    return s_log_line_info;
+}
+
+#endif
 
-static void find_args_from_index(va_list *va, size_t index)
+void xf_log_set_time_func(xf_log_time_func_t log_time_func)
 {
-    for (int i = 0; i < index; i++) {
-        va_arg(*va, void *);
-    }
+    s_log_time_func = log_time_func;
+#if XF_LOG_CALLSITE_IS_ENABLE
+    // 调用点报告的窗口从设置时间戳函数时开始，之前的窗口没有起始时间，不输出速率
+    s_log_callsite_window_time = log_time_func ? log_time_func() : 0;
+    s_log_callsite_window_valid = (log_time_func != NULL);
+#endif
 }
 
-static size_t xf_log_vprintf(xf_log_out_t log_out, void *arg, const char *format, va_list va)
+void xf_log_set_tick_func(xf_log_tick_func_t log_tick_func)
 {
-    const char *p = format;
-    char format_flag[XF_FORMAT_FLAG_SIZE];         // 用于格式化部分的缓冲区
-    char format_buffer[XF_FORMAT_BUFFER_SIZE];      // 用于格式化结果的缓冲区
-    size_t total_length = 0;
-    size_t index = 0, used_index = 0;
-    va_list args_copy;
+    s_log_tick_func = log_tick_func;
+}
 
-    while (*p != '\0') {
-        // 普通字符处理，直接输出到串口
-        if (*p != '%') {
-            const char *start = p;
-            while (*p != '%' && *p != '\0') {
-                p++;  // 找到下一个 '%' 或者字符串末尾
-            }
-            total_length += p - start;
-            log_out(start, p - start, arg);  // 输出普通文本部分
-        } else {
-            p++;  // 移动到 % 后面的字符
-            char *format_start = format_flag;  // 记录 % 开始的地方
-            *format_start = '%';
-            format_start++;
-            used_index = 0;
-
-            // 优化一些特殊情况
-            if (*p == '%') {
-                p++;
-                total_length++;
-                log_out("%", 1, arg);
-                continue;
-            } else if (*p == 's') {
-                p++;
-                va_copy(args_copy, va);
-                find_args_from_index(&args_copy, index);
-                const char *start = va_arg(args_copy, const char *);
-                index++;
-                va_end(args_copy);
-                total_length += xf_log_strlen(start);
-                log_out(start, xf_log_strlen(start), arg);
-                continue;
-            }
+#if XF_LOG_ASYNC_IS_ENABLE
 
-            // 收录格式控制符
-            switch (*p) {
-            case '-':
-            case '+':
-            case ' ':
-            case '#':
-            case '0':
-                if ((format_start - format_flag) < XF_FORMAT_FLAG_SIZE - 1) {
-                    *format_start++ = *p++;
-                }
-                break;
+int xf_log_set_async_enable(int log_obj_id, xf_log_policy_t policy, uint32_t timeout)
+{
+    if (log_obj_id < 0 || log_obj_id >= XF_LOG_OBJ_NUM || s_log_obj[log_obj_id].out_func == NULL) {
+        return -1;
+    }
 
-            default:
-                break;
-            }
-            // 收录宽度信息
-            if (*p == '*') {
-                used_index++;
-                if ((format_start - format_flag) < XF_FORMAT_FLAG_SIZE - 1) {
-                    *format_start++ = *p++;
-                }
-            } else {
-                while (isdigit((int)(*p))) {
-                    if ((format_start - format_flag) < XF_FORMAT_FLAG_SIZE - 1) {
-                        *format_start++ = *p++;
-                    }
-                }
-            }
+    // 没有时间戳函数时无法计时，有限的超时只能是 0
+    if (s_log_time_func == NULL && policy == XF_LOG_POLICY_BLOCK && timeout != 0 && timeout != XF_LOG_WAIT_FOREVER) {
+        return -1;
+    }
 
-            // 收录位置信息
-            if (*p == '.') {
-                if ((format_start - format_flag) < XF_FORMAT_FLAG_SIZE - 1) {
-                    *format_start++ = *p++;
-                }
-                if (*p == '*') {
-                    used_index++;
-                    if ((format_start - format_flag) < XF_FORMAT_FLAG_SIZE - 1) {
-                        *format_start++ = *p++;
-                    }
-                } else {
-                    while (isdigit((int)(*p))) {
-                        if ((format_start - format_flag) < XF_FORMAT_FLAG_SIZE - 1) {
-                            *format_start++ = *p++;
-                        }
-                    }
-                }
-            }
-            // 收录长度
-            switch (*p) {
-            case 'h':
-            case 'l':
-            case 'j':
-            case 'z':
-            case 't': {
-                if ((format_start - format_flag) < XF_FORMAT_FLAG_SIZE - 1) {
-                    *format_start++ = *p++;
-                }
-                switch (*p) {
-                case 'h':
-                case 'l':
-                    if ((format_start - format_flag) < XF_FORMAT_FLAG_SIZE - 1) {
-                        *format_start++ = *p++;
-                    }
-                    break;
-
-                default:
-                    break;
-                }
-            }
-            break;
+    xf_log_queue_t *q = &s_log_obj[log_obj_id].queue;
+    xf_log_spin_lock(&q->lock);
+    q->timeout = timeout;
+    q->policy = policy;
+    xf_log_atomic_store_release(&q->enable, 1);
+    xf_log_spin_unlock(&q->lock);
 
-            default:
-                break;
-            }
-            // 收录类型转换符
-            switch (*p) {
-            case 'E':
-            case 'F':
-            case 'G':
-            case 'X':
-            case 'b':
-            case 'c':
-            case 'd':
-            case 'e':
-            case 'f':
-            case 'g':
-            case 'i':
-            case 'o':
-            case 'p':
-            case 's':
-            case 't':
-            case 'u':
-            case 'x':
-                used_index++;
-                if ((format_start - format_flag) < XF_FORMAT_FLAG_SIZE - 1) {
-                    *format_start++ = *p++;
-                }
-                break;
+    return 0;
+}
 
-            default:
-                break;
-            }
+int xf_log_set_async_disable(int log_obj_id)
+{
+    if (log_obj_id < 0 || log_obj_id >= XF_LOG_OBJ_NUM || s_log_obj[log_obj_id].out_func == NULL) {
+        return -1;
+    }
 
-            *format_start = '\0';  // 结束符
-            // 格式化字符串并输出;
-            va_copy(args_copy, va);
-            find_args_from_index(&args_copy, index);
-            // 获取完整格式化的长度
-            int formatted_len = xf_log_vsprintf(format_buffer, XF_FORMAT_BUFFER_SIZE, format_flag, args_copy);
-            va_end(args_copy);
-            if (formatted_len < XF_FORMAT_BUFFER_SIZE) {
-                log_out(format_buffer, formatted_len, arg);
-                total_length += formatted_len;
-            } else {
-                int total_written = 0;
-                while (total_written < formatted_len) {
-                    int remaining = formatted_len - total_written;
-                    int chunk_size = remaining < XF_FORMAT_BUFFER_SIZE ? remaining : XF_FORMAT_BUFFER_SIZE - 1;
-                    va_copy(args_copy, va);
-                    find_args_from_index(&args_copy, index);
-                    xf_log_vsprintf(format_buffer, chunk_size + 1, format_flag, args_copy);  // 输出分块格式化内容
-                    va_end(args_copy);
-                    log_out(format_buffer, chunk_size, arg);
-                    total_written += chunk_size;
-                }
-                total_length += total_written;
-            }
-            index += used_index;
-        }
+    // 先停止入队，再把队列中剩余的记录输出
+    xf_log_queue_t *q = &s_log_obj[log_obj_id].queue;
+    xf_log_spin_lock(&q->lock);
+    xf_log_atomic_store_release(&q->enable, 0);
+    xf_log_spin_unlock(&q->lock);
+    while (xf_log_atomic_load(&q->draining)) {
+        xf_log_yield();
     }
+    xf_log_flush(log_obj_id);
 
-    return total_length;
+    return 0;
 }
 
+void xf_log_set_async_notify(int log_obj_id, xf_log_notify_t notify, void *user_args)
+{
+    xf_log_queue_t *q = &s_log_obj[log_obj_id].queue;
+
+    xf_log_spin_lock(&q->lock);
+    q->notify = notify;
+    q->notify_args = user_args;
+    xf_log_spin_unlock(&q->lock);
+}
+
+size_t xf_log_flush(int log_obj_id)
+{
+    size_t count = 0;
+
+    // 只排空活动列表中的后端，注销等待排空结束后才会释放后端
+    XF_LOG_READ_LOCK(epoch);
+    const xf_log_active_t *active = XF_LOG_ACTIVE();
+    for (size_t k = 0; k < active->num; k++) {
+        if (log_obj_id == -1 || log_obj_id == active->id[k]) {
+            count += xf_log_queue_drain(active->id[k]);
+        }
+    }
+    XF_LOG_READ_UNLOCK(epoch);
+
+    return count;
+}
+
+#endif
+
+#if XF_LOG_SHARD_IS_ENABLE
+
+int xf_log_set_shard_enable(int log_obj_id)
+{
+    if (log_obj_id < 0 || log_obj_id >= XF_LOG_OBJ_NUM || s_log_obj[log_obj_id].out_func == NULL) {
+        return -1;
+    }
+
+    xf_log_atomic_store_release(&s_log_obj[log_obj_id].shard, 1);
+
+    return 0;
+}
+
+int xf_log_set_shard_disable(int log_obj_id)
+{
+    if (log_obj_id < 0 || log_obj_id >= XF_LOG_OBJ_NUM) {
+        return -1;
+    }
+
+    // 与注册、注销互斥，同一时刻只有一个上下文等待宽限期
+#if XF_LOG_DYNAMIC_IS_ENABLE
+    xf_log_spin_lock(&s_log_obj_lock);
+#endif
+    int ret = -1;
+    if (s_log_obj[log_obj_id].out_func != NULL) {
+        xf_log_shard_stop(log_obj_id, 0);
+        ret = 0;
+    }
+#if XF_LOG_DYNAMIC_IS_ENABLE
+    xf_log_spin_unlock(&s_log_obj_lock);
+#endif
+
+    return ret;
+}
+
+void xf_log_set_shard_window(uint32_t window)
+{
+    s_log_shard_window = window;
+}
+
+size_t xf_log_shard_process(void)
+{
+    return xf_log_shard_merge(0);
+}
+
+size_t xf_log_shard_flush(void)
+{
+    return xf_log_shard_merge(1);
+}
+
+#endif
+
+#if XF_LOG_STATS_IS_ENABLE
+
+int xf_log_get_stats(int log_obj_id, xf_log_stats_t *stats)
+{
+    if (stats == NULL || log_obj_id < -1 || log_obj_id >= XF_LOG_OBJ_NUM) {
+        return -1;
+    }
+
+    uint32_t *dst = (uint32_t *)stats;
+    for (size_t k = 0; k < sizeof(xf_log_stats_t) / sizeof(uint32_t); k++) {
+        dst[k] = 0;
+    }
+
+    // 读取时汇总各分片，-1 时再汇总所有log对象
+    for (size_t s = 0; s < XF_LOG_STATS_SHARD_NUM; s++) {
+        for (size_t i = 0; i < XF_LOG_OBJ_NUM; i++) {
+            if (log_obj_id != -1 && log_obj_id != (int)i) {
+                continue;
+            }
+            uint32_t *src = (uint32_t *)&s_log_stats[s][i];
+            for (size_t k = 0; k < sizeof(xf_log_stats_t) / sizeof(uint32_t); k++) {
+                dst[k] += xf_log_atomic_load(&src[k]);
+            }
+        }
+    }
+
+    return 0;
+}
+
+void xf_log_stats_dump(int log_obj_id)
+{
+    char name[] = "obj 000";
+
+    XF_LOG_READ_LOCK(epoch);
+    const xf_log_active_t *active = XF_LOG_ACTIVE();
+    for (size_t k = 0; k < active->num; k++) {
+        size_t i = active->id[k];
+        if (log_obj_id != -1 && log_obj_id != (int)i) {
+            continue;
+        }
+        name[4 + xf_log_utoa(&name[4], i)] = '\0';
+        xf_log_stats_dump_one(name, i);
+    }
+    XF_LOG_READ_UNLOCK(epoch);
+
+    if (log_obj_id == -1) {
+        xf_log_stats_dump_one("total", -1);
+    }
+}
+
+void xf_log_set_stats_dump_period(uint32_t period)
+{
+    if (s_log_time_func) {
+        s_log_stats_last = s_log_time_func();
+    }
+    s_log_stats_period = period;
+}
+
+#endif
+
+#if XF_LOG_BUDGET_IS_ENABLE
+
+void xf_log_set_budget(uint32_t bytes, uint32_t records, uint32_t period)
+{
+    // 先关闭再修改，避免周期检查读到一半的设置
+    xf_log_atomic_store(&s_log_budget_period, 0);
+    s_log_budget_bytes_limit = bytes;
+    s_log_budget_records_limit = records;
+    s_log_budget_bytes_base = xf_log_atomic_load(&s_log_budget_bytes);
+    s_log_budget_records_base = xf_log_atomic_load(&s_log_budget_records);
+    s_log_budget_calm = 0;
+    s_log_budget_hold = XF_LOG_BUDGET_HOLD_NUM;
+    s_log_budget_restored = 0;
+    if (s_log_time_func) {
+        xf_log_atomic_store(&s_log_budget_last, s_log_time_func());
+    }
+    xf_log_atomic_store(&xf_log_gate_level, s_log_budget_level);
+    xf_log_atomic_store_release(&s_log_budget_period, period);
+}
+
+void xf_log_set_level(uint8_t level)
+{
+    s_log_budget_level = level;
+    s_log_budget_calm = 0;
+    s_log_budget_hold = XF_LOG_BUDGET_HOLD_NUM;
+    s_log_budget_restored = 0;
+    xf_log_atomic_store(&xf_log_gate_level, level);
+}
+
+uint8_t xf_log_get_level(void)
+{
+    return xf_log_atomic_load(&xf_log_gate_level);
+}
+
+#endif
+
+size_t xf_log(uint8_t level, const char *tag, const char *file, uint32_t line, const char *func, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    size_t len = xf_log_va(level, tag, file, line, func, fmt, args, NULL);
+    va_end(args);
+
+    return len;
+}
+
+#if XF_LOG_CALLSITE_IS_ENABLE
+
+size_t xf_log_callsite(xf_log_callsite_t *callsite, uint8_t level, const char *tag, ...)
+{
+    size_t emitted = 0;
+    va_list args;
+
+    if (!xf_log_atomic_load_acquire(&callsite->registered)) {
+        xf_log_callsite_register(callsite, tag);
+    }
+    xf_log_atomic_add(&callsite->hits, 1);
+
+    // 已解析的调用点在格式化时跳过解析，输出期间嵌套的log会保存并恢复
+    const xf_log_callsite_t *prev = s_log_callsite_cur;
+    s_log_callsite_cur = xf_log_atomic_load_acquire(&callsite->spec_num) ? callsite : NULL;
+    va_start(args, tag);
+    size_t len = xf_log_va(level, tag, callsite->file, callsite->line, callsite->func, callsite->fmt, args, &emitted);
+    va_end(args);
+    s_log_callsite_cur = prev;
+
+    if (emitted) {
+        xf_log_atomic_add(&callsite->bytes, len);
+    } else {
+        xf_log_atomic_add(&callsite->filtered, 1);
+    }
+
+    return len;
+}
+
+size_t xf_log_callsite_top(xf_log_callsite_t **top, size_t num)
+{
+    size_t count = 0;
+
+    if (top == NULL || num == 0) {
+        return 0;
+    }
+
+    // 按报告窗口内的命中次数插入排序，只保留前 num 个
+    xf_log_callsite_t *callsite = xf_log_atomic_load_acquire(&s_log_callsite_head);
+    for (; callsite != NULL; callsite = callsite->next) {
+        uint32_t rate = xf_log_atomic_load(&callsite->hits) - callsite->window_hits;
+        if (rate == 0) {
+            continue;
+        }
+        size_t pos = count;
+        if (count < num) {
+            count++;
+        } else if (rate <= xf_log_atomic_load(&top[num - 1]->hits) - top[num - 1]->window_hits) {
+            continue;
+        } else {
+            pos = num - 1;
+        }
+        while (pos > 0 && xf_log_atomic_load(&top[pos - 1]->hits) - top[pos - 1]->window_hits < rate) {
+            top[pos] = top[pos - 1];
+            pos--;
+        }
+        top[pos] = callsite;
+    }
+
+    return count;
+}
+
+void xf_log_callsite_dump(size_t num)
+{
+    xf_log_callsite_t *top[XF_LOG_CALLSITE_TOP_NUM];
+
+    if (num == 0 || num > XF_LOG_CALLSITE_TOP_NUM) {
+        num = XF_LOG_CALLSITE_TOP_NUM;
+    }
+    size_t count = xf_log_callsite_top(top, num);
+    uint32_t now = s_log_time_func ? s_log_time_func() : 0;
+    uint32_t elapsed = s_log_callsite_window_valid ? now - s_log_callsite_window_time : 0;
+
+    // 报告直接调用 xf_log 输出，不经过调用点，不会计入自身的统计
+    if (elapsed) {
+        xf_log(XF_LOG_LVL_INFO, "xf_log", XF_LOG_FILE, __LINE__, __func__,
+               "top %lu callsites in %lu ticks:" XF_LOG_NEWLINE, (unsigned long)count, (unsigned long)elapsed);
+    } else {
+        xf_log(XF_LOG_LVL_INFO, "xf_log", XF_LOG_FILE, __LINE__, __func__,
+               "top %lu callsites:" XF_LOG_NEWLINE, (unsigned long)count);
+    }
+    for (size_t i = 0; i < count; i++) {
+        xf_log_callsite_t *callsite = top[i];
+        uint32_t hits = xf_log_atomic_load(&callsite->hits);
+        // 去掉格式化字符串末尾的换行，避免报告被拆成多行
+        size_t fmt_len = xf_log_strlen(callsite->fmt);
+        while (fmt_len > 0 && (callsite->fmt[fmt_len - 1] == '\n' || callsite->fmt[fmt_len - 1] == '\r')) {
+            fmt_len--;
+        }
+        uint32_t window = hits - callsite->window_hits;
+        uint32_t bytes = xf_log_atomic_load(&callsite->bytes);
+        uint32_t filtered = xf_log_atomic_load(&callsite->filtered);
+        const char *tag = callsite->tag ? callsite->tag : "";
+        if (elapsed) {
+            // 按窗口时长折算成每 1000 个时间单位（tick）的命中次数
+            xf_log(XF_LOG_LVL_INFO, "xf_log", XF_LOG_FILE, __LINE__, __func__,
+                   "#%lu %s:%lu(%s) tag %s: +%lu hits (%lu/1000 ticks, %lu total), %lu bytes, %lu filtered, \"%.*s\""
+                   XF_LOG_NEWLINE, (unsigned long)i + 1, callsite->file, (unsigned long)callsite->line,
+                   callsite->func, tag, (unsigned long)window,
+                   (unsigned long)((unsigned long long)window * 1000 / elapsed), (unsigned long)hits,
+                   (unsigned long)bytes, (unsigned long)filtered, (int)fmt_len, callsite->fmt);
+        } else {
+            xf_log(XF_LOG_LVL_INFO, "xf_log", XF_LOG_FILE, __LINE__, __func__,
+                   "#%lu %s:%lu(%s) tag %s: +%lu hits (%lu total), %lu bytes, %lu filtered, \"%.*s\""
+                   XF_LOG_NEWLINE, (unsigned long)i + 1, callsite->file, (unsigned long)callsite->line,
+                   callsite->func, tag, (unsigned long)window, (unsigned long)hits,
+                   (unsigned long)bytes, (unsigned long)filtered, (int)fmt_len, callsite->fmt);
+        }
+    }
+
+    // 开启新的报告窗口
+    s_log_callsite_window_time = now;
+    s_log_callsite_window_valid = (s_log_time_func != NULL);
+    xf_log_callsite_t *callsite = xf_log_atomic_load_acquire(&s_log_callsite_head);
+    for (; callsite != NULL; callsite = callsite->next) {
+        callsite->window_hits = xf_log_atomic_load(&callsite->hits);
+    }
+}
+
+void xf_log_callsite_dump_request(void)
+{
+    xf_log_atomic_store(&s_log_callsite_dump_pending, 1);
+}
+
+#endif
+
+size_t xf_log_printf(const char *format, ...)
+{
+    size_t len = 0;
+    size_t count = 0;
+#if XF_LOG_ASYNC_IS_ENABLE
+    xf_log_record_t *record = NULL;
+#endif
+#if XF_LOG_SHARD_IS_ENABLE
+    uint32_t shard_mask = 0;
+#endif
+    va_list args;
+    va_start(args, format);
+#if XF_LOG_STATIC_IS_ENABLE
+    len = xf_log_static_vprintf(format, args);
+#endif
+    XF_LOG_READ_LOCK(epoch);
+    const xf_log_active_t *active = XF_LOG_ACTIVE();
+    for (size_t k = 0; k < active->num; k++) {
+        size_t i = active->id[k];
+#if XF_LOG_SHARD_IS_ENABLE
+        if (xf_log_atomic_load_acquire(&s_log_obj[i].shard)) {
+            shard_mask |= 1UL << i;
+            continue;
+        }
+#endif
+#if XF_LOG_ASYNC_IS_ENABLE
+        // 异步的后端同样经过队列，保证与 log 记录的先后顺序
+        if (xf_log_atomic_load_acquire(&s_log_obj[i].queue.enable)) {
+            if (record == NULL) {
+                record = xf_log_record_create(XF_LOG_LVL_NONE, 0, NULL, NULL, 0, NULL, format, args);
+            }
+            int ret = xf_log_queue_push(i, record);
+            if (ret >= 0) {
+                len = record ? record->len : 0;
+                count += ret;
+                continue;
+            }
+            // 入队前异步输出已被关闭，改为直接输出
+        }
+#endif
+        len = xf_log_obj_vprintf(i, format, args);
+        count++;
+    }
+#if XF_LOG_SHARD_IS_ENABLE
+    if (shard_mask && xf_log_shard_push(shard_mask, XF_LOG_LVL_NONE, 0, NULL, NULL, 0, NULL, format, args, &len)) {
+        for (size_t i = 0; i < XF_LOG_OBJ_NUM; i++) {
+            count += (shard_mask >> i) & 1;
+        }
+    }
+#endif
+#if XF_LOG_BUDGET_IS_ENABLE
+    xf_log_atomic_add(&s_log_budget_records, (uint32_t)count);
+#endif
+    XF_LOG_READ_UNLOCK(epoch);
+    va_end(args);
+
+#if XF_LOG_ASYNC_IS_ENABLE
+    if (record) {
+        xf_log_record_release(record);
+    }
+#endif
+
+    return len;
+}
+
+size_t xf_log_snprintf(char *buf, size_t size, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    size_t len = xf_log_vsnprintf(buf, size, format, args);
+    va_end(args);
+
+    return len;
+}
+
+size_t xf_log_vsnprintf(char *buf, size_t size, const char *format, va_list va)
+{
+    xf_log_cursor_t cursor;
+
+    xf_log_cursor_init(&cursor, buf, size);
+    xf_log_vprintf(xf_log_buf_out, &cursor, format, va);
+
+    return xf_log_cursor_end(&cursor);
+}
+
+void xf_log_cursor_init(xf_log_cursor_t *cursor, char *buf, size_t size)
+{
+    cursor->data = buf;
+    cursor->size = buf ? size : 0;
+    cursor->len = 0;
+}
+
+size_t xf_log_cursor_write(xf_log_cursor_t *cursor, const char *str, size_t len)
+{
+    xf_log_buf_out(str, len, cursor);
+
+    return len;
+}
+
+size_t xf_log_cursor_printf(xf_log_cursor_t *cursor, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    size_t len = xf_log_vprintf(xf_log_buf_out, cursor, format, args);
+    va_end(args);
+
+    return len;
+}
+
+size_t xf_log_cursor_vprintf(xf_log_cursor_t *cursor, const char *format, va_list va)
+{
+    return xf_log_vprintf(xf_log_buf_out, cursor, format, va);
+}
+
+size_t xf_log_cursor_end(xf_log_cursor_t *cursor)
+{
+    // 与 snprintf 相同，空间不足时截断并保留结尾的 '\0'
+    if (cursor->size > 0) {
+        cursor->data[cursor->len < cursor->size ? cursor->len : cursor->size - 1] = '\0';
+    }
+
+    return cursor->len;
+}
+
+#if XF_LOG_HEX_IS_ENABLE
+
+size_t xf_log_buffer_hex(uint8_t level, const char *tag, const char *file, uint32_t line, const char *func,
+                         const void *buf, size_t len)
+{
+    return xf_log_buffer_out(level, tag, file, line, func, (const uint8_t *)buf, len, 0);
+}
+
+size_t xf_log_buffer_hexdump(uint8_t level, const char *tag, const char *file, uint32_t line, const char *func,
+                             const void *buf, size_t len)
+{
+    return xf_log_buffer_out(level, tag, file, line, func, (const uint8_t *)buf, len, 1);
+}
+
+#endif
+
+#if XF_LOG_ISR_IS_ENABLE
+
+int xf_log_isr(const xf_log_isr_site_t *site, const char *tag, uint8_t num, ...)
+{
+    xf_log_isr_slot_t *slot = NULL;
+    uint32_t pos = xf_log_atomic_load(&s_log_isr_head);
+
+    // 申请槽位：槽位的序号与申请的序号一致时才可写，用尽时直接丢弃，不等待
+    while (1) {
+        slot = &s_log_isr_slot[pos & (XF_LOG_ISR_SLOT_NUM - 1)];
+        int32_t diff = (int32_t)(xf_log_atomic_load_acquire(&slot->seq) - XF_LOG_ISR_LAP(pos));
+        if (diff == 0) {
+            if (xf_log_atomic_cas(&s_log_isr_head, &pos, pos + 1)) {
+                break;
+            }
+        } else if (diff < 0) {
+            xf_log_atomic_add(&s_log_isr_dropped, 1);
+            return -1;
+        } else {
+            pos = xf_log_atomic_load(&s_log_isr_head);
+        }
+    }
+
+    // 按格式控制符的真实类型读取参数，'*' 对应的宽度和精度按 int 各占一个参数
+    uint8_t max = num < XF_LOG_ISR_ARG_NUM ? num : XF_LOG_ISR_ARG_NUM;
+    uint8_t k = 0;
+    xf_log_spec_t spec;
+    va_list args;
+    va_start(args, num);
+    slot->site = site;
+    slot->tag = tag;
+    for (const char *p = site->fmt; *p != '\0';) {
+        p += xf_log_spec_parse(p, &spec);
+        if (spec.type == XF_LOG_SPEC_TEXT) {
+            continue;
+        }
+        uint8_t star = spec.arg >> XF_LOG_ARG_STAR_SHIFT;
+        if (k + star + 1 > max) {
+            break;
+        }
+        for (; star > 0; star--, k++) {
+            slot->type[k] = XF_LOG_ARG_INT;
+            xf_log_isr_arg_read(&slot->args[k], XF_LOG_ARG_INT, &args);
+        }
+        slot->type[k] = spec.arg & XF_LOG_ARG_TYPE_MASK;
+        xf_log_isr_arg_read(&slot->args[k], slot->type[k], &args);
+        k++;
+    }
+    va_end(args);
+    slot->num = k;
+    xf_log_atomic_store_release(&slot->seq, XF_LOG_ISR_LAP(pos) + 1);
+
+    return 0;
+}
+
+size_t xf_log_isr_process(void)
+{
+    size_t count = 0;
+
+    while (1) {
+        uint32_t pos = s_log_isr_tail;
+        xf_log_isr_slot_t *slot = &s_log_isr_slot[pos & (XF_LOG_ISR_SLOT_NUM - 1)];
+        if (xf_log_atomic_load_acquire(&slot->seq) != XF_LOG_ISR_LAP(pos) + 1) {
+            break;
+        }
+
+        // 先取出内容再归还槽位，格式化输出期间中断可以继续写入
+        const xf_log_isr_site_t *site = slot->site;
+        const char *tag = slot->tag;
+        uint8_t num = slot->num;
+        uint8_t type[XF_LOG_ISR_ARG_NUM];
+        xf_log_isr_arg_t a[XF_LOG_ISR_ARG_NUM];
+        for (uint8_t i = 0; i < num; i++) {
+            type[i] = slot->type[i];
+            a[i] = slot->args[i];
+        }
+        xf_log_atomic_store_release(&slot->seq, XF_LOG_ISR_LAP(pos) + XF_LOG_ISR_SLOT_NUM);
+        s_log_isr_tail = pos + 1;
+
+        // 参数无法重新组成 va_list，先逐个按原类型格式化出正文，再作为 %s 输出
+        char body[XF_LOG_LINE_SIZE];
+        xf_log_isr_render(body, sizeof(body), site->fmt, a, type, num);
+        xf_log(site->level, tag, site->file, site->line, site->func, "%s" XF_LOG_NEWLINE, body);
+        count++;
+    }
+
+    uint32_t dropped = xf_log_atomic_load(&s_log_isr_dropped);
+    if (dropped != s_log_isr_reported) {
+        xf_log(XF_LOG_LVL_WARN, "xf_log", XF_LOG_FILE, __LINE__, __func__, "%lu isr records dropped" XF_LOG_NEWLINE,
+               (unsigned long)(dropped - s_log_isr_reported));
+        s_log_isr_reported = dropped;
+    }
+
+    return count;
+}
+
+#endif
+
+/* ==================== [Static Functions] ================================== */
+
+#if XF_LOG_FILTER_IS_ENABLE
+
+static int xf_log_is_filtered(size_t log_obj_id, uint8_t level, const char *tag, const char *file)
+{
+    switch (xf_log_filter_reason(log_obj_id, level, tag, file)) {
+    case XF_LOG_FILTER_LEVEL:
+        XF_LOG_STATS_ADD(log_obj_id, filtered_level, 1);
+        return 1;
+    case XF_LOG_FILTER_TAG:
+        XF_LOG_STATS_ADD(log_obj_id, filtered_tag, 1);
+        return 1;
+    case XF_LOG_FILTER_FILE:
+        XF_LOG_STATS_ADD(log_obj_id, filtered_file, 1);
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static uint8_t xf_log_filter_reason(size_t log_obj_id, uint8_t level, const char *tag, const char *file)
+{
+    // 根据屏蔽等级判断后续是否执行
+    xf_log_filter_t filter = s_log_obj[log_obj_id].filter;
+    if (filter.enable) {
+        if (filter.b_or_w == 0) {
+            if (filter.level < level) {
+                return XF_LOG_FILTER_LEVEL;
+            } else if (filter.tag != NULL && filter.tag == tag) {
+                return XF_LOG_FILTER_TAG;
+            } else if (filter.file != NULL && filter.file == file) {
+                return XF_LOG_FILTER_FILE;
+            }
+
+        } else if (filter.b_or_w == 1) {
+            if (filter.level < level) {
+                return XF_LOG_FILTER_LEVEL;
+            } else if (filter.tag != NULL && filter.tag != tag) {
+                return XF_LOG_FILTER_TAG;
+            } else if (filter.file != NULL && filter.file != file) {
+                return XF_LOG_FILTER_FILE;
+            }
+        }
+    }
+
+    return XF_LOG_FILTER_NONE;
+}
+
+#endif
+
+static size_t xf_log_va(uint8_t level, const char *tag, const char *file, uint32_t line, const char *func,
+                        const char *fmt, va_list va, size_t *emitted)
+{
+    size_t len = 0;
+    size_t count = 0;
+    uint32_t time = s_log_time_func ? s_log_time_func() : 0;
+#if XF_LOG_ASYNC_IS_ENABLE
+    xf_log_record_t *record = NULL;
+#endif
+#if XF_LOG_SHARD_IS_ENABLE
+    uint32_t shard_mask = 0;
+#endif
+
+#if XF_LOG_STATIC_IS_ENABLE
+    len = xf_log_static_format(level, time, tag, file, line, func, fmt, va, &count);
+#endif
+
+    // 根据不同的订阅进行不同的输出，只遍历已注册的后端
+    XF_LOG_READ_LOCK(epoch);
+    const xf_log_active_t *active = XF_LOG_ACTIVE();
+    for (size_t k = 0; k < active->num; k++) {
+        size_t i = active->id[k];
+#if XF_LOG_FILTER_IS_ENABLE
+        if (xf_log_is_filtered(i, level, tag, file)) {
+            continue;
+        }
+#endif
+#if XF_LOG_SHARD_IS_ENABLE
+        if (xf_log_atomic_load_acquire(&s_log_obj[i].shard)) {
+            // 记录只写入一次分片，合并时再分发给各后端
+            shard_mask |= 1UL << i;
+            continue;
+        }
+#endif
+#if XF_LOG_ASYNC_IS_ENABLE
+        if (xf_log_atomic_load_acquire(&s_log_obj[i].queue.enable)) {
+            // 正文只格式化一次，由所有异步后端共享
+            if (record == NULL) {
+                record = xf_log_record_create(level, time, tag, file, line, func, fmt, va);
+            }
+            // 丢弃的记录只计入 dropped，异步输出已被关闭或者等待超时时改为直接输出
+            int ret = xf_log_queue_push(i, record);
+            if (ret >= 0) {
+                len = record ? record->len : 0;
+                if (ret > 0) {
+                    XF_LOG_STATS_ADD(i, emitted, 1);
+                    count++;
+                }
+                continue;
+            }
+        }
+#endif
+        len = xf_log_obj_format(i, level, time, tag, file, line, func, fmt, va);
+        XF_LOG_STATS_ADD(i, emitted, 1);
+        count++;
+    }
+#if XF_LOG_SHARD_IS_ENABLE
+    // 分片已满时记录只计入 dropped，写入成功后才计为输出
+    if (shard_mask && xf_log_shard_push(shard_mask, level, time, tag, file, line, func, fmt, va, &len)) {
+        for (size_t i = 0; i < XF_LOG_OBJ_NUM; i++) {
+            if (shard_mask & (1UL << i)) {
+                XF_LOG_STATS_ADD(i, emitted, 1);
+                count++;
+            }
+        }
+    }
+#endif
+    XF_LOG_READ_UNLOCK(epoch);
+
+#if XF_LOG_ASYNC_IS_ENABLE
+    if (record) {
+        xf_log_record_release(record);
+    }
+#endif
+
+    if (emitted) {
+        *emitted = count;
+    }
+
+#if XF_LOG_STATS_IS_ENABLE
+    xf_log_stats_poll();
+#endif
+
+#if XF_LOG_CALLSITE_IS_ENABLE
+    xf_log_callsite_poll();
+#endif
+
+#if XF_LOG_BUDGET_IS_ENABLE
+    // 字节数已在各后端输出时计入，这里只计入记录数
+    xf_log_atomic_add(&s_log_budget_records, (uint32_t)count);
+    xf_log_budget_poll();
+#endif
+
+    return len;
+}
+
+static size_t xf_log_spec_parse(const char *p, xf_log_spec_t *spec)
+{
+    const char *start = p;
+    uint8_t star = 0;
+    char length = 0;
+    char length2 = 0;
+
+    spec->type = XF_LOG_SPEC_TEXT;
+    spec->arg = XF_LOG_ARG_NONE;
+
+    // 普通文本，直到下一个 '%' 或者字符串末尾
+    if (*p != '%') {
+        while (*p != '%' && *p != '\0' && p - start < 0xFF) {
+            p++;
+        }
+        spec->len = p - start;
+        return spec->len;
+    }
+    p++;
+    if (*p == '%') {
+        spec->len = 1;
+        return 2;
+    }
+
+    // 收录格式控制符、宽度和精度
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') {
+        p++;
+    }
+    if (*p == '*') {
+        star++;
+        p++;
+    } else {
+        while (isdigit((int)(*p))) {
+            p++;
+        }
+    }
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            star++;
+            p++;
+        } else {
+            while (isdigit((int)(*p))) {
+                p++;
+            }
+        }
+    }
+
+    // 收录长度
+    switch (*p) {
+    case 'h':
+    case 'l':
+    case 'j':
+    case 'z':
+    case 't':
+    case 'L':
+        length = *p++;
+        if ((length == 'h' || length == 'l') && *p == length) {
+            length2 = *p++;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    // 根据类型转换符确定参数的类型，之后按真实的类型跳过参数
+    switch (*p) {
+    case 'd':
+    case 'i':
+    case 'o':
+    case 'u':
+    case 'x':
+    case 'X':
+        spec->type = XF_LOG_SPEC_CONV;
+        if (length == 'l') {
+            spec->arg = length2 ? XF_LOG_ARG_LLONG : XF_LOG_ARG_LONG;
+        } else if (length == 'j') {
+            spec->arg = XF_LOG_ARG_LLONG;
+        } else if (length == 'z' || length == 't') {
+            spec->arg = XF_LOG_ARG_SIZE;
+        } else {
+            spec->arg = XF_LOG_ARG_INT;
+        }
+        break;
+
+    case 'c':
+        spec->type = XF_LOG_SPEC_CONV;
+        spec->arg = XF_LOG_ARG_INT;
+        break;
+
+    case 'e':
+    case 'E':
+    case 'f':
+    case 'F':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        spec->type = XF_LOG_SPEC_CONV;
+        spec->arg = length == 'L' ? XF_LOG_ARG_LDOUBLE : XF_LOG_ARG_DOUBLE;
+        break;
+
+    case 'p':
+        spec->type = XF_LOG_SPEC_CONV;
+        spec->arg = XF_LOG_ARG_PTR;
+        break;
+
+    case 's':
+        spec->type = length ? XF_LOG_SPEC_CONV : XF_LOG_SPEC_STR;
+        spec->arg = XF_LOG_ARG_PTR;
+        break;
+
+    default:
+        // 不支持的类型转换符原样输出，不消耗参数
+        star = 0;
+        break;
+    }
+    if (*p != '\0') {
+        p++;
+    }
+
+    if (p - start > 0xFF) {
+        spec->type = XF_LOG_SPEC_TEXT;
+        spec->arg = XF_LOG_ARG_NONE;
+        spec->len = 0xFF;
+        return spec->len;
+    }
+    spec->arg |= star << XF_LOG_ARG_STAR_SHIFT;
+    spec->len = p - start;
+
+    return spec->len;
+}
+
+static void xf_log_arg_skip(va_list *va, uint8_t arg)
+{
+    for (uint8_t i = arg >> XF_LOG_ARG_STAR_SHIFT; i > 0; i--) {
+        (void)va_arg(*va, int);
+    }
+
+    switch (arg & XF_LOG_ARG_TYPE_MASK) {
+    case XF_LOG_ARG_INT:
+        (void)va_arg(*va, int);
+        break;
+    case XF_LOG_ARG_LONG:
+        (void)va_arg(*va, long);
+        break;
+    case XF_LOG_ARG_LLONG:
+        (void)va_arg(*va, long long);
+        break;
+    case XF_LOG_ARG_SIZE:
+        (void)va_arg(*va, size_t);
+        break;
+    case XF_LOG_ARG_DOUBLE:
+        (void)va_arg(*va, double);
+        break;
+    case XF_LOG_ARG_LDOUBLE:
+        (void)va_arg(*va, long double);
+        break;
+    case XF_LOG_ARG_PTR:
+        (void)va_arg(*va, void *);
+        break;
+    default:
+        break;
+    }
+}
+
+#if XF_LOG_ISR_IS_ENABLE
+
+static void xf_log_isr_arg_read(xf_log_isr_arg_t *a, uint8_t type, va_list *va)
+{
+    switch (type) {
+    case XF_LOG_ARG_INT:
+        a->i = va_arg(*va, int);
+        break;
+    case XF_LOG_ARG_LONG:
+        a->i = va_arg(*va, long);
+        break;
+    case XF_LOG_ARG_LLONG:
+        a->i = va_arg(*va, long long);
+        break;
+    case XF_LOG_ARG_SIZE:
+        a->i = (long long)va_arg(*va, size_t);
+        break;
+    case XF_LOG_ARG_DOUBLE:
+        a->d = va_arg(*va, double);
+        break;
+    case XF_LOG_ARG_LDOUBLE:
+        a->ld = va_arg(*va, long double);
+        break;
+    case XF_LOG_ARG_PTR:
+        a->p = va_arg(*va, const void *);
+        break;
+    default:
+        break;
+    }
+}
+
+static int xf_log_isr_sprintf(char *buffer, size_t maxlen, const char *fmt, ...)
+{
+    va_list va;
+    va_start(va, fmt);
+    int len = xf_log_vsprintf(buffer, maxlen, fmt, va);
+    va_end(va);
+
+    return len;
+}
+
+static int xf_log_isr_conv(char *buffer, size_t maxlen, const char *flag, const xf_log_isr_arg_t *a,
+                           const uint8_t *type, uint8_t star)
+{
+    // 前面 star 个参数是 '*' 对应的 int，最后一个参数按记录的类型还原
+#define XF_LOG_ISR_CONV(value)  do {                                                                \
+        switch (star) {                                                                             \
+        case 0:                                                                                     \
+            return xf_log_isr_sprintf(buffer, maxlen, flag, value);                                 \
+        case 1:                                                                                     \
+            return xf_log_isr_sprintf(buffer, maxlen, flag, (int)a[0].i, value);                    \
+        default:                                                                                    \
+            return xf_log_isr_sprintf(buffer, maxlen, flag, (int)a[0].i, (int)a[1].i, value);       \
+        }                                                                                           \
+    } while (0)
+
+    switch (type[star]) {
+    case XF_LOG_ARG_INT:
+        XF_LOG_ISR_CONV((int)a[star].i);
+    case XF_LOG_ARG_LONG:
+        XF_LOG_ISR_CONV((long)a[star].i);
+    case XF_LOG_ARG_LLONG:
+        XF_LOG_ISR_CONV(a[star].i);
+    case XF_LOG_ARG_SIZE:
+        XF_LOG_ISR_CONV((size_t)a[star].i);
+    case XF_LOG_ARG_DOUBLE:
+        XF_LOG_ISR_CONV(a[star].d);
+    case XF_LOG_ARG_LDOUBLE:
+        XF_LOG_ISR_CONV(a[star].ld);
+    case XF_LOG_ARG_PTR:
+        XF_LOG_ISR_CONV(a[star].p);
+    default:
+        return 0;
+    }
+#undef XF_LOG_ISR_CONV
+}
+
+static size_t xf_log_isr_render(char *buffer, size_t size, const char *fmt, const xf_log_isr_arg_t *a,
+                                const uint8_t *type, uint8_t num)
+{
+    char format_flag[XF_FORMAT_FLAG_SIZE];
+    xf_log_spec_t spec;
+    size_t len = 0;
+    uint8_t k = 0;
+
+    for (const char *p = fmt; *p != '\0' && len < size - 1;) {
+        size_t n = xf_log_spec_parse(p, &spec);
+        uint8_t star = spec.arg >> XF_LOG_ARG_STAR_SHIFT;
+        int formatted_len = -1;
+
+        // 与 xf_log_spec_out 一致，格式控制符超出缓冲区时原样输出；参数没有记录下来时也原样输出
+        if (spec.type != XF_LOG_SPEC_TEXT && spec.len < XF_FORMAT_FLAG_SIZE && k + star + 1 <= num) {
+            for (size_t i = 0; i < spec.len; i++) {
+                format_flag[i] = p[i];
+            }
+            format_flag[spec.len] = '\0';
+            formatted_len = xf_log_isr_conv(buffer + len, size - len, format_flag, &a[k], &type[k], star);
+        }
+        if (spec.type != XF_LOG_SPEC_TEXT) {
+            k += star + 1;
+        }
+        if (formatted_len < 0) {
+            formatted_len = spec.len < size - 1 - len ? spec.len : size - 1 - len;
+            for (int i = 0; i < formatted_len; i++) {
+                buffer[len + i] = p[i];
+            }
+        }
+        len += (size_t)formatted_len < size - 1 - len ? (size_t)formatted_len : size - 1 - len;
+        p += n;
+    }
+    buffer[len] = '\0';
+
+    return len;
+}
+
+#endif
+
+static size_t xf_log_spec_str(xf_log_out_t log_out, void *arg, const char *start, size_t len, va_list *va)
+{
+    static const char spaces[] = "                ";
+    const char *p = start + 1;
+    const char *end = start + len - 1;
+    uint8_t left = 0;
+    size_t width = 0;
+    size_t precision = (size_t) -1;
+
+    // %s 直接输出，宽度和精度在这里处理，不经过 vsnprintf 也不受格式化缓冲区大小的限制
+    for (; p < end && (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0'); p++) {
+        left |= *p == '-';
+    }
+    if (*p == '*') {
+        int star = va_arg(*va, int);
+        left |= star < 0;
+        width = star < 0 ? -(size_t)star : (size_t)star;
+        p++;
+    } else {
+        for (; isdigit((int)(*p)); p++) {
+            width = width * 10 + (*p - '0');
+        }
+    }
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            int star = va_arg(*va, int);
+            precision = star < 0 ? (size_t) -1 : (size_t)star;
+        } else {
+            for (precision = 0; isdigit((int)(*p)); p++) {
+                precision = precision * 10 + (*p - '0');
+            }
+        }
+    }
+
+    const char *str = va_arg(*va, const char *);
+    if (str == NULL) {
+        str = "(null)";
+    }
+    size_t str_len = 0;
+    while (str_len < precision && str[str_len] != '\0') {
+        str_len++;
+    }
+
+    size_t pad = width > str_len ? width - str_len : 0;
+    if (!left) {
+        for (size_t n = pad; n > 0; n -= n < sizeof(spaces) - 1 ? n : sizeof(spaces) - 1) {
+            log_out(spaces, n < sizeof(spaces) - 1 ? n : sizeof(spaces) - 1, arg);
+        }
+    }
+    log_out(str, str_len, arg);
+    if (left) {
+        for (size_t n = pad; n > 0; n -= n < sizeof(spaces) - 1 ? n : sizeof(spaces) - 1) {
+            log_out(spaces, n < sizeof(spaces) - 1 ? n : sizeof(spaces) - 1, arg);
+        }
+    }
+
+    return str_len + pad;
+}
+
+static size_t xf_log_spec_out(xf_log_out_t log_out, void *arg, const char *start, const xf_log_spec_t *spec,
+                              va_list *va)
+{
+    char format_flag[XF_FORMAT_FLAG_SIZE];         // 用于格式化部分的缓冲区
+    char format_buffer[XF_FORMAT_BUFFER_SIZE];      // 用于格式化结果的缓冲区
+    va_list args_copy;
+
+    if (spec->type == XF_LOG_SPEC_TEXT) {
+        log_out(start, spec->len, arg);
+        return spec->len;
+    }
+    if (spec->type == XF_LOG_SPEC_STR) {
+        return xf_log_spec_str(log_out, arg, start, spec->len, va);
+    }
+
+    // 格式控制符超出缓冲区时原样输出，但仍然跳过对应的参数
+    if (spec->len >= XF_FORMAT_FLAG_SIZE) {
+        log_out(start, spec->len, arg);
+        xf_log_arg_skip(va, spec->arg);
+        return spec->len;
+    }
+    for (size_t i = 0; i < spec->len; i++) {
+        format_flag[i] = start[i];
+    }
+    format_flag[spec->len] = '\0';
+
+    // 格式化当前参数后按真实的类型跳过，下一个格式控制符从这里继续
+    va_copy(args_copy, *va);
+    int formatted_len = xf_log_vsprintf(format_buffer, XF_FORMAT_BUFFER_SIZE, format_flag, args_copy);
+    va_end(args_copy);
+    xf_log_arg_skip(va, spec->arg);
+
+    if (formatted_len < 0) {
+        return 0;
+    }
+    // 超出格式化缓冲区的结果被截断
+    if (formatted_len >= XF_FORMAT_BUFFER_SIZE) {
+        formatted_len = XF_FORMAT_BUFFER_SIZE - 1;
+    }
+    log_out(format_buffer, formatted_len, arg);
+
+    return formatted_len;
+}
+
+static size_t xf_log_vprintf(xf_log_out_t log_out, void *arg, const char *format, va_list va)
+{
+    size_t total_length = 0;
+    xf_log_spec_t spec;
+    va_list args;
+
+    // 调用者会把同一个 va 交给多个后端，这里只消耗副本
+    va_copy(args, va);
+
+#if XF_LOG_CALLSITE_IS_ENABLE
+    // 调用点首次输出时已经解析过格式化字符串，直接使用解析结果
+    const xf_log_callsite_t *callsite = s_log_callsite_cur;
+    if (callsite != NULL && callsite->fmt == format) {
+        for (size_t k = 0; k < callsite->spec_num; k++) {
+            total_length += xf_log_spec_out(log_out, arg, format + callsite->spec[k].pos, &callsite->spec[k], &args);
+        }
+        va_end(args);
+        return total_length;
+    }
+#endif
+
+    for (const char *p = format; *p != '\0';) {
+        size_t len = xf_log_spec_parse(p, &spec);
+        total_length += xf_log_spec_out(log_out, arg, p, &spec, &args);
+        p += len;
+    }
+    va_end(args);
+
+    return total_length;
+}
+
+#if !XF_LOG_LAYOUT_IS_ENABLE || XF_LOG_STATIC_IS_ENABLE
+
 static size_t xf_log_printf_out(xf_log_out_t log_out, void *arg, const char *format, ...)
 {
     va_list va;
-    va_start(va, format);
-    size_t len = xf_log_vprintf(log_out, arg, format, va);
+    va_start(va, format);
+    size_t len = xf_log_vprintf(log_out, arg, format, va);
+    va_end(va);
+
+    return len;
+}
+
+#endif
+
+static size_t xf_log_color_format(int log_obj_id, xf_log_out_t out_func, void *user_args, uint8_t level,
+                                  uint32_t time, const char *tag, const char *file, uint32_t line,
+                                  const char *func, const char *fmt, va_list va)
+{
+#if XF_LOG_LAYOUT_IS_ENABLE
+    return xf_log_layout_format(log_obj_id, out_func, user_args, level, time, tag, file, line, func, fmt, va);
+#else
+    uint8_t colorful = 1;
+#if XF_LOG_FILTER_IS_ENABLE
+    colorful = !s_log_obj[log_obj_id].filter.enable || s_log_obj[log_obj_id].filter.is_colorful;
+#endif
+
+    return xf_log_record_format(out_func, user_args, level <= s_log_obj[log_obj_id].info_level, colorful,
+                                level, time, tag, file, line, func, fmt, va);
+#endif
+}
+
+#if !XF_LOG_LAYOUT_IS_ENABLE || XF_LOG_STATIC_IS_ENABLE
+
+static size_t xf_log_record_format(xf_log_out_t out_func, void *user_args, uint8_t info, uint8_t colorful,
+                                   uint8_t level, uint32_t time, const char *tag, const char *file, uint32_t line,
+                                   const char *func, const char *fmt, va_list va)
+{
+    size_t len = 0;
+
+#if XF_LOG_COLORS_IS_ENABLE
+    if (colorful && s_lvl_to_color[level] != XF_LOG_COLOR_NULL) {
+        /* \033[0;3%cm: 重置样式并设置前景色 */
+        len += xf_log_printf_out(out_func, user_args, PL_CSI_START "0;3" "%cm", s_lvl_to_color[level]);
+    }
+#endif
+
+    // 添加时间戳打印
+    if (s_log_time_func) {
+        len += xf_log_printf_out(out_func, user_args, "%c (%lu)-%s", s_lvl_to_prompt[level], (unsigned long)time, tag);
+    } else {
+        len += xf_log_printf_out(out_func, user_args, "%c %s", s_lvl_to_prompt[level], tag);
+    }
+
+    // 打印信息
+    if (info) {
+        len += xf_log_printf_out(out_func, user_args, "[%s:%lu(%s)]", file, line, func);
+    }
+
+    // 用户日志打印
+    len += xf_log_printf_out(out_func, user_args, ": ");
+    len += xf_log_vprintf(out_func, user_args, fmt, va);
+
+#if XF_LOG_COLORS_IS_ENABLE
+    /* 清除 CSI 格式 */
+    if (colorful && s_lvl_to_color[level] != XF_LOG_COLOR_NULL) {
+        len += xf_log_printf_out(out_func, user_args, PL_CSI_END);
+    }
+#endif
+
+    return len;
+}
+
+#endif
+
+static size_t xf_log_obj_format(int log_obj_id, uint8_t level, uint32_t time, const char *tag, const char *file,
+                                uint32_t line, const char *func, const char *fmt, va_list va)
+{
+#if XF_LOG_LINE_OUT_IS_ENABLE
+    // 先在栈上拼出整条记录，保证面向记录的后端每次收到完整的一行
+    if (s_log_obj[log_obj_id].line_out) {
+        char data[XF_LOG_LINE_SIZE];
+        xf_log_cursor_t buf = {data, XF_LOG_LINE_SIZE, 0};
+        size_t len = xf_log_color_format(log_obj_id, xf_log_buf_out, &buf, level, time, tag, file, line, func, fmt, va);
+
+        // 输出期间后端可以通过 xf_log_get_line_info 取得这条记录的信息
+        va_list args;
+        va_copy(args, va);
+        xf_log_line_info_t info = {level, time, tag, file, line, func, fmt, &args};
+        const xf_log_line_info_t *prev = s_log_line_info;
+        s_log_line_info = &info;
+        size_t out_len = xf_log_buf_end(&buf, 1);
+        XF_LOG_OBJ_OUT_FUNC(log_obj_id)(data, out_len, XF_LOG_OBJ_OUT_ARGS(log_obj_id));
+        XF_LOG_BUDGET_CHARGE(out_len);
+        s_log_line_info = prev;
+        va_end(args);
+        return len;
+    }
+#endif
+
+    size_t len = xf_log_color_format(log_obj_id, XF_LOG_OBJ_OUT_FUNC(log_obj_id), XF_LOG_OBJ_OUT_ARGS(log_obj_id),
+                                     level, time, tag, file, line, func, fmt, va);
+    XF_LOG_BUDGET_CHARGE(len);
+
+    return len;
+}
+
+static size_t xf_log_obj_vprintf(int log_obj_id, const char *format, va_list va)
+{
+#if XF_LOG_LINE_OUT_IS_ENABLE
+    if (s_log_obj[log_obj_id].line_out) {
+        char data[XF_LOG_LINE_SIZE];
+        xf_log_cursor_t buf = {data, XF_LOG_LINE_SIZE, 0};
+        size_t len = xf_log_vprintf(xf_log_buf_out, &buf, format, va);
+        size_t out_len = xf_log_buf_end(&buf, 0);
+        XF_LOG_OBJ_OUT_FUNC(log_obj_id)(data, out_len, XF_LOG_OBJ_OUT_ARGS(log_obj_id));
+        XF_LOG_BUDGET_CHARGE(out_len);
+        return len;
+    }
+#endif
+
+    size_t len = xf_log_vprintf(XF_LOG_OBJ_OUT_FUNC(log_obj_id), XF_LOG_OBJ_OUT_ARGS(log_obj_id), format, va);
+    XF_LOG_BUDGET_CHARGE(len);
+
+    return len;
+}
+
+#if XF_LOG_STATIC_IS_ENABLE
+
+static size_t xf_log_static_format(uint8_t level, uint32_t time, const char *tag, const char *file, uint32_t line,
+                                   const char *func, const char *fmt, va_list va, size_t *count)
+{
+    char data[XF_LOG_LINE_SIZE];
+    xf_log_cursor_t buf = {data, XF_LOG_LINE_SIZE, 0};
+    size_t len = 0;
+    int style = -1;     // 缓冲区中记录的样式，位 0 为位置信息，位 1 为颜色，-1 表示还没有格式化
+
+#if XF_LOG_LINE_OUT_IS_ENABLE
+    va_list args;
+    va_copy(args, va);
+    xf_log_line_info_t line_info = {level, time, tag, file, line, func, fmt, &args};
+    const xf_log_line_info_t *prev = s_log_line_info;
+    s_log_line_info = &line_info;
+#endif
+
+    // 等级、过滤和样式都是常量，展开后每个后端只剩几次比较和一次直接调用
+    // 记录只在位置信息或颜色与上一个后端不同时重新格式化
+#define XF_LOG_STATIC_OUT(out_func, user_args, max_level, info_level, colorful, tag_filter, file_filter)  \
+    if (XF_LOG_STATIC_ACCEPT(max_level, tag_filter, file_filter, level, tag, file)) {                   \
+        if (style != ((level <= (info_level)) | (!!(colorful) << 1))) {                                 \
+            style = (level <= (info_level)) | (!!(colorful) << 1);                                      \
+            buf.len = 0;                                                                                \
+            len = xf_log_record_format(xf_log_buf_out, &buf, style & 1, style >> 1, level, time, tag,   \
+                                       file, line, func, fmt, va);                                      \
+            xf_log_buf_end(&buf, 1);                                                                    \
+        }                                                                                               \
+        out_func(data, buf.len, (user_args));                                                           \
+        XF_LOG_BUDGET_CHARGE(buf.len);                                                                  \
+        (*count)++;                                                                                     \
+    }
+    XF_LOG_STATIC_OBJS(XF_LOG_STATIC_OUT)
+#undef XF_LOG_STATIC_OUT
+
+#if XF_LOG_LINE_OUT_IS_ENABLE
+    s_log_line_info = prev;
+    va_end(args);
+#endif
+
+    return len;
+}
+
+static size_t xf_log_static_vprintf(const char *format, va_list va)
+{
+    char data[XF_LOG_LINE_SIZE];
+    xf_log_cursor_t buf = {data, XF_LOG_LINE_SIZE, 0};
+
+    size_t len = xf_log_vprintf(xf_log_buf_out, &buf, format, va);
+    xf_log_buf_end(&buf, 0);
+
+#define XF_LOG_STATIC_OUT(out_func, user_args, max_level, info_level, colorful, tag_filter, file_filter) \
+    out_func(data, buf.len, (user_args));                                                               \
+    XF_LOG_BUDGET_CHARGE(buf.len);
+    XF_LOG_STATIC_OBJS(XF_LOG_STATIC_OUT)
+#undef XF_LOG_STATIC_OUT
+
+    return len;
+}
+
+static int xf_log_static_match(const char *expect, const char *str)
+{
+    if (expect == str) {
+        return 1;
+    }
+    if (str == NULL) {
+        return 0;
+    }
+    while (*expect != '\0' && *expect == *str) {
+        expect++;
+        str++;
+    }
+
+    return *expect == *str;
+}
+
+#endif
+
+static void xf_log_buf_out(const char *str, size_t len, void *arg)
+{
+    xf_log_cursor_t *buf = (xf_log_cursor_t *)arg;
+
+    for (size_t i = 0; i < len && buf->len + i < buf->size; i++) {
+        buf->data[buf->len + i] = str[i];
+    }
+    buf->len += len;
+}
+
+#if XF_LOG_ASYNC_IS_ENABLE || XF_LOG_LINE_OUT_IS_ENABLE || XF_LOG_SHARD_IS_ENABLE || XF_LOG_STATIC_IS_ENABLE
+
+static size_t xf_log_buf_end(xf_log_cursor_t *buf, uint8_t newline)
+{
+    // 超长的内容被截断，log 记录保证以换行结尾
+    if (buf->len > buf->size) {
+        if (newline) {
+            size_t newline_len = sizeof(XF_LOG_NEWLINE) - 1;
+            for (size_t k = 0; k < newline_len; k++) {
+                buf->data[buf->size - newline_len + k] = XF_LOG_NEWLINE[k];
+            }
+        }
+        buf->len = buf->size;
+    }
+
+    return buf->len;
+}
+
+#endif
+
+#if XF_LOG_LAYOUT_IS_ENABLE
+
+static int xf_log_layout_compile(xf_log_layout_t *layout, const char *pattern)
+{
+    const char *p = pattern;
+    size_t num = 0;
+    int group = -1;
+
+    while (*p) {
+        if (num >= XF_LOG_LAYOUT_OP_NUM) {
+            return -1;
+        }
+        xf_log_layout_op_t *op = &layout->op[num];
+
+        // 连续的文本合并为一个操作，"%%" 从第二个 % 开始作为文本
+        if (*p != '%' || p[1] == '%') {
+            const char *start = (*p == '%') ? p + 1 : p;
+            const char *end = start + 1;
+            while (*end != '\0' && *end != '%' && end - start < 255) {
+                end++;
+            }
+            if (start - pattern > 255) {
+                return -1;
+            }
+            op->type = XF_LOG_LAYOUT_OP_TEXT;
+            op->pos = start - pattern;
+            op->len = end - start;
+            num++;
+            p = end;
+            continue;
+        }
+
+        switch (p[1]) {
+        case 'T':
+            op->type = XF_LOG_LAYOUT_OP_TIME;
+            break;
+        case 'L':
+            op->type = XF_LOG_LAYOUT_OP_LEVEL;
+            break;
+        case 't':
+            op->type = XF_LOG_LAYOUT_OP_TAG;
+            break;
+        case 'f':
+            op->type = XF_LOG_LAYOUT_OP_FILE;
+            break;
+        case 'l':
+            op->type = XF_LOG_LAYOUT_OP_LINE;
+            break;
+        case 'F':
+            op->type = XF_LOG_LAYOUT_OP_FUNC;
+            break;
+        case 'm':
+            op->type = XF_LOG_LAYOUT_OP_MSG;
+            break;
+        case 'C':
+            op->type = XF_LOG_LAYOUT_OP_COLOR;
+            break;
+        case 'R':
+            op->type = XF_LOG_LAYOUT_OP_RESET;
+            break;
+        case '[':
+            if (group != -1) {
+                return -1;
+            }
+            group = num;
+            op->type = XF_LOG_LAYOUT_OP_INFO;
+            break;
+        case ']':
+            // 条件组结束只回填跳过的操作数，本身不占操作
+            if (group == -1) {
+                return -1;
+            }
+            layout->op[group].len = num - group - 1;
+            group = -1;
+            p += 2;
+            continue;
+        default:
+            return -1;
+        }
+        op->pos = 0;
+        op->len = 0;
+        num++;
+        p += 2;
+    }
+
+    if (group != -1) {
+        return -1;
+    }
+    layout->pattern = pattern;
+    layout->num = num;
+
+    return 0;
+}
+
+static size_t xf_log_layout_format(int log_obj_id, xf_log_out_t out_func, void *user_args, uint8_t level,
+                                   uint32_t time, const char *tag, const char *file, uint32_t line,
+                                   const char *func, const char *fmt, va_list va)
+{
+    const xf_log_layout_t *layout =
+        &s_log_obj[log_obj_id].layout[xf_log_atomic_load_acquire(&s_log_obj[log_obj_id].layout_cur)];
+    uint8_t colorful = 0;
+    size_t len = 0;
+    char num_buf[10];
+
+    if (layout->pattern == NULL) {
+        layout = &s_log_layout_default[s_log_time_func != NULL];
+    }
+
+#if XF_LOG_COLORS_IS_ENABLE
+    colorful = s_lvl_to_color[level] != XF_LOG_COLOR_NULL;
+#if XF_LOG_FILTER_IS_ENABLE
+    colorful = colorful && (!s_log_obj[log_obj_id].filter.enable || s_log_obj[log_obj_id].filter.is_colorful);
+#endif
+#endif
+
+    // 按编译好的操作依次输出，文本直接引用格式字符串，不再经过格式化
+    for (size_t k = 0; k < layout->num; k++) {
+        const xf_log_layout_op_t *op = &layout->op[k];
+        const char *str = NULL;
+        size_t n = 0;
+
+        switch (op->type) {
+        case XF_LOG_LAYOUT_OP_TEXT:
+            str = layout->pattern + op->pos;
+            n = op->len;
+            break;
+        case XF_LOG_LAYOUT_OP_TIME:
+            str = num_buf;
+            n = xf_log_utoa(num_buf, time);
+            break;
+        case XF_LOG_LAYOUT_OP_LEVEL:
+            str = &s_lvl_to_prompt[level];
+            n = 1;
+            break;
+        case XF_LOG_LAYOUT_OP_TAG:
+            str = tag;
+            n = tag ? xf_log_strlen(tag) : 0;
+            break;
+        case XF_LOG_LAYOUT_OP_FILE:
+            str = file;
+            n = file ? xf_log_strlen(file) : 0;
+            break;
+        case XF_LOG_LAYOUT_OP_LINE:
+            str = num_buf;
+            n = xf_log_utoa(num_buf, line);
+            break;
+        case XF_LOG_LAYOUT_OP_FUNC:
+            str = func;
+            n = func ? xf_log_strlen(func) : 0;
+            break;
+        case XF_LOG_LAYOUT_OP_MSG:
+            len += xf_log_vprintf(out_func, user_args, fmt, va);
+            break;
+        case XF_LOG_LAYOUT_OP_COLOR:
+            if (colorful) {
+                str = s_lvl_to_csi[level];
+                n = sizeof(PL_CSI_START "0;30m") - 1;
+            }
+            break;
+        case XF_LOG_LAYOUT_OP_RESET:
+            if (colorful) {
+                str = PL_CSI_END;
+                n = sizeof(PL_CSI_END) - 1;
+            }
+            break;
+        case XF_LOG_LAYOUT_OP_INFO:
+            if (level > s_log_obj[log_obj_id].info_level) {
+                k += op->len;
+            }
+            break;
+        default:
+            break;
+        }
+
+        if (n) {
+            out_func(str, n, user_args);
+            len += n;
+        }
+    }
+
+    return len;
+}
+
+#endif
+
+#if XF_LOG_HEX_IS_ENABLE
+
+static int xf_log_is_enabled(uint8_t level, const char *tag, const char *file)
+{
+    int enabled = 0;
+
+#if XF_LOG_STATIC_IS_ENABLE
+#define XF_LOG_STATIC_ENABLED(out_func, user_args, max_level, info_level, colorful, tag_filter, file_filter) \
+    enabled |= XF_LOG_STATIC_ACCEPT(max_level, tag_filter, file_filter, level, tag, file);
+    XF_LOG_STATIC_OBJS(XF_LOG_STATIC_ENABLED)
+#undef XF_LOG_STATIC_ENABLED
+    if (enabled) {
+        return 1;
+    }
+#endif
+
+    // 只判断不计数，被过滤的统计由之后每一行的输出负责
+    XF_LOG_READ_LOCK(epoch);
+    const xf_log_active_t *active = XF_LOG_ACTIVE();
+#if XF_LOG_FILTER_IS_ENABLE
+    for (size_t k = 0; k < active->num && !enabled; k++) {
+        enabled = xf_log_filter_reason(active->id[k], level, tag, file) == XF_LOG_FILTER_NONE;
+    }
+#else
+    enabled = active->num > 0;
+#endif
+    XF_LOG_READ_UNLOCK(epoch);
+
+    return enabled;
+}
+
+static size_t xf_log_buffer_out(uint8_t level, const char *tag, const char *file, uint32_t line, const char *func,
+                                const uint8_t *data, size_t len, uint8_t dump)
+{
+    char text[XF_LOG_HEX_TEXT_SIZE];
+    size_t total = 0;
+
+    if (data == NULL || len == 0 || !xf_log_is_enabled(level, tag, file)) {
+        return 0;
+    }
+
+    // 查表转换，整行拼好后作为一条记录输出，避免逐字节经过格式化
+    for (size_t offset = 0; offset < len; offset += XF_LOG_HEX_LINE_WIDTH) {
+        size_t num = len - offset < XF_LOG_HEX_LINE_WIDTH ? len - offset : XF_LOG_HEX_LINE_WIDTH;
+        char *p = text;
+
+        if (dump) {
+            uint32_t pos = offset;
+            for (int i = 7; i >= 0; i--) {
+                p[i] = s_hex_digits[pos & 0xF];
+                pos >>= 4;
+            }
+            p += 8;
+            *p++ = ' ';
+            for (size_t i = 0; i < XF_LOG_HEX_LINE_WIDTH; i++) {
+                if (i % 8 == 0) {
+                    *p++ = ' ';
+                }
+                if (i < num) {
+                    p[0] = s_hex_digits[data[offset + i] >> 4];
+                    p[1] = s_hex_digits[data[offset + i] & 0xF];
+                } else {
+                    p[0] = ' ';
+                    p[1] = ' ';
+                }
+                p[2] = ' ';
+                p += 3;
+            }
+            *p++ = ' ';
+            *p++ = '|';
+            for (size_t i = 0; i < num; i++) {
+                uint8_t c = data[offset + i];
+                *p++ = (c >= 0x20 && c < 0x7F) ? (char)c : '.';
+            }
+            *p++ = '|';
+        } else {
+            for (size_t i = 0; i < num; i++) {
+                p[0] = s_hex_digits[data[offset + i] >> 4];
+                p[1] = s_hex_digits[data[offset + i] & 0xF];
+                p += 2;
+            }
+        }
+        *p = '\0';
+
+        total += xf_log(level, tag, file, line, func, "%s" XF_LOG_NEWLINE, text);
+    }
+
+    return total;
+}
+
+#endif
+
+#if XF_LOG_DYNAMIC_IS_ENABLE
+
+static uint32_t *xf_log_read_lock(void)
+{
+    // 每个线程首次使用时分配一个分片，0 表示尚未分配
+    static XF_LOG_THREAD_LOCAL uint8_t s_shard = 0;
+    if (s_shard == 0) {
+        s_shard = xf_log_atomic_add(&s_log_epoch_shard_next, 1) % XF_LOG_EPOCH_SHARD_NUM + 1;
+    }
+
+    uint32_t *readers = &s_log_epoch_readers[xf_log_atomic_load(&s_log_epoch) & 1][s_shard - 1];
+    xf_log_atomic_add(readers, 1);
+    // 计数对写者可见之后才读取活动列表，与 xf_log_synchronize 中的屏障配对
+    xf_log_atomic_fence();
+
+    return readers;
+}
+
+static void xf_log_synchronize(void)
+{
+    // 翻转两次纪元，每次等待翻转前纪元的读者全部退出
+    // 两个纪元的计数都在发布之后清零过一次，说明发布前进入的读者都已结束
+    for (size_t k = 0; k < 2; k++) {
+        xf_log_atomic_fence();
+        uint32_t epoch = xf_log_atomic_load(&s_log_epoch);
+        xf_log_atomic_store(&s_log_epoch, epoch + 1);
+        for (size_t s = 0; s < XF_LOG_EPOCH_SHARD_NUM; s++) {
+            while (xf_log_atomic_load_acquire(&s_log_epoch_readers[epoch & 1][s])) {
+                xf_log_yield();
+            }
+        }
+    }
+}
+
+static void xf_log_active_publish(size_t log_obj_id, uint8_t add)
+{
+    // 在读者不再使用的另一份列表上修改，然后整体发布
+    xf_log_active_t *cur = s_log_active_cur;
+    xf_log_active_t *next = (cur == &s_log_active[0]) ? &s_log_active[1] : &s_log_active[0];
+    uint32_t num = 0;
+
+    for (size_t k = 0; k < cur->num; k++) {
+        if (cur->id[k] != log_obj_id) {
+            next->id[num++] = cur->id[k];
+        }
+    }
+    if (add) {
+        next->id[num++] = log_obj_id;
+    }
+    next->num = num;
+    xf_log_atomic_store_release(&s_log_active_cur, next);
+
+    // 等待仍在使用旧列表的读者退出，之后旧列表可以被下一次修改复用
+    xf_log_synchronize();
+}
+
+#endif
+
+#if XF_LOG_ASYNC_IS_ENABLE || XF_LOG_DYNAMIC_IS_ENABLE || XF_LOG_SHARD_IS_ENABLE
+
+static void xf_log_spin_lock(uint8_t *lock)
+{
+    uint8_t expected = 0;
+    while (!xf_log_atomic_cas(lock, &expected, 1)) {
+        while (xf_log_atomic_load(lock)) {
+            xf_log_yield();
+        }
+        expected = 0;
+    }
+}
+
+static void xf_log_spin_unlock(uint8_t *lock)
+{
+    xf_log_atomic_store_release(lock, 0);
+}
+
+#endif
+
+#if XF_LOG_ASYNC_IS_ENABLE || XF_LOG_SHARD_IS_ENABLE
+
+static size_t xf_log_obj_printf(int log_obj_id, uint8_t level, uint32_t time, const char *tag, const char *file,
+                                uint32_t line, const char *func, const char *fmt, ...)
+{
+    va_list va;
+    va_start(va, fmt);
+    size_t len = xf_log_obj_format(log_obj_id, level, time, tag, file, line, func, fmt, va);
     va_end(va);
 
     return len;
 }
 
-static size_t xf_log_color_format(int log_obj_id, uint8_t level, const char *tag, const char *file, uint32_t line,
-                                  const char *func, const char *fmt, va_list va)
+#endif
+
+#if XF_LOG_ASYNC_IS_ENABLE
+
+static xf_log_record_t *xf_log_record_create(uint8_t level, uint32_t time, const char *tag, const char *file,
+                                             uint32_t line, const char *func, const char *fmt, va_list va)
 {
-    size_t len = 0;
-    xf_log_out_t out_func = s_log_obj[log_obj_id].out_func;
-    void *user_args = s_log_obj[log_obj_id].user_args;
+    xf_log_record_t *record = NULL;
+
+    // 从上次分配的位置开始找一个空闲的记录，引用计数置 1 由调用者持有
+    uint32_t hint = xf_log_atomic_add(&s_log_record_hint, 1);
+    for (size_t k = 0; k < XF_LOG_RECORD_NUM; k++) {
+        xf_log_record_t *r = &s_log_record[(hint + k) % XF_LOG_RECORD_NUM];
+        uint32_t expected = 0;
+        if (xf_log_atomic_load(&r->ref) == 0 && xf_log_atomic_cas(&r->ref, &expected, 1)) {
+            record = r;
+            break;
+        }
+    }
+    if (record == NULL) {
+        return NULL;
+    }
 
-#if XF_LOG_COLORS_IS_ENABLE
-#if XF_LOG_FILTER_IS_ENABLE
-    if (!s_log_obj[log_obj_id].filter.enable || (s_log_obj[log_obj_id].filter.enable
-            && s_log_obj[log_obj_id].filter.is_colorful)) {
-#endif
-        if (s_lvl_to_color[level] != XF_LOG_COLOR_NULL) {
-            /* \033[0;3%cm: 重置样式并设置前景色 */
-            len += xf_log_printf_out(out_func, user_args, PL_CSI_START "0;3" "%cm", s_lvl_to_color[level]);
+    record->level = level;
+    record->time = time;
+    record->tag = tag;
+    record->file = file;
+    record->line = line;
+    record->func = func;
+
+    xf_log_cursor_t buf = {record->body, XF_LOG_RECORD_SIZE, 0};
+    xf_log_vprintf(xf_log_buf_out, &buf, fmt, va);
+    record->len = xf_log_buf_end(&buf, level != XF_LOG_LVL_NONE);
+
+    return record;
+}
+
+static void xf_log_record_release(xf_log_record_t *record)
+{
+    xf_log_atomic_sub(&record->ref, 1);
+}
+
+static int xf_log_queue_is_full(xf_log_queue_t *q, uint8_t level)
+{
+    uint32_t limit = XF_LOG_QUEUE_SIZE;
+
+    // 按等级分配水位，DEBUG 及以下最先被丢弃，ERROR 及以上可以使用全部空间
+    if (q->policy == XF_LOG_POLICY_BY_LEVEL) {
+        if (level >= XF_LOG_LVL_DEBUG) {
+            limit = XF_LOG_QUEUE_SIZE / 2;
+        } else if (level >= XF_LOG_LVL_WARN) {
+            limit = XF_LOG_QUEUE_SIZE / 4 * 3;
         }
-#if XF_LOG_FILTER_IS_ENABLE
     }
+
+    return q->head - q->tail >= limit;
+}
+
+static void xf_log_queue_drop_at(int log_obj_id, uint32_t pos)
+{
+    xf_log_queue_t *q = &s_log_obj[log_obj_id].queue;
+
+    // 挤掉 pos 处的记录，更旧的记录依次后移一格，保持先后顺序
+    xf_log_record_release(q->slot[pos % XF_LOG_QUEUE_SIZE]);
+    for (; pos != q->tail; pos--) {
+        q->slot[pos % XF_LOG_QUEUE_SIZE] = q->slot[(pos - 1) % XF_LOG_QUEUE_SIZE];
+    }
+    xf_log_atomic_store(&q->tail, q->tail + 1);
+    q->drop_pos = q->tail;
+    q->dropped++;
+    XF_LOG_STATS_ADD(log_obj_id, dropped, 1);
+}
+
+static int xf_log_queue_push(int log_obj_id, xf_log_record_t *record)
+{
+    xf_log_queue_t *q = &s_log_obj[log_obj_id].queue;
+    uint32_t start = s_log_time_func ? s_log_time_func() : 0;
+    xf_log_notify_t notify = NULL;
+    void *notify_args = NULL;
+
+    xf_log_spin_lock(&q->lock);
+    // 异步输出已被关闭时由调用者直接输出，记录池耗尽时按丢弃处理
+    if (!q->enable) {
+        goto disabled;
+    }
+    if (record == NULL) {
+        goto drop;
+    }
+
+    while (xf_log_queue_is_full(q, record->level)) {
+        if (q->policy == XF_LOG_POLICY_DROP_NEWEST) {
+            goto drop;
+        } else if (q->policy == XF_LOG_POLICY_DROP_OLDEST && q->head != q->tail) {
+            xf_log_queue_drop_at(log_obj_id, q->tail);
+            continue;
+        } else if (q->policy == XF_LOG_POLICY_BY_LEVEL) {
+            if (record->level > XF_LOG_LVL_ERROR) {
+                goto drop;
+            }
+            // ERROR 及以上的记录挤掉队列中最旧的低于 ERROR 的记录，没有时再等待空间
+            uint32_t pos = q->tail;
+            while (pos != q->head && q->slot[pos % XF_LOG_QUEUE_SIZE]->level <= XF_LOG_LVL_ERROR) {
+                pos++;
+            }
+            if (pos != q->head) {
+                xf_log_queue_drop_at(log_obj_id, pos);
+                continue;
+            }
+        }
+
+        // 阻塞等待排空，等待期间不持锁，超时后丢弃新记录；按等级丢弃时 ERROR 及以上超时后改为直接输出
+        uint32_t tail = q->tail;
+        xf_log_spin_unlock(&q->lock);
+        while (xf_log_atomic_load(&q->tail) == tail && xf_log_atomic_load(&q->enable)) {
+            if (q->timeout != XF_LOG_WAIT_FOREVER
+                    && (s_log_time_func == NULL || s_log_time_func() - start >= q->timeout)) {
+                xf_log_spin_lock(&q->lock);
+                if (q->policy == XF_LOG_POLICY_BY_LEVEL) {
+                    goto direct;
+                }
+                goto drop;
+            }
+            xf_log_yield();
+        }
+        xf_log_spin_lock(&q->lock);
+        if (!q->enable) {
+            goto disabled;
+        }
+    }
+
+    // 队列由空变为非空时通知排空上下文
+    if (q->head == q->tail) {
+        notify = q->notify;
+        notify_args = q->notify_args;
+    }
+    xf_log_atomic_add(&record->ref, 1);
+    q->slot[q->head % XF_LOG_QUEUE_SIZE] = record;
+    q->head++;
+    xf_log_spin_unlock(&q->lock);
+
+    if (notify) {
+        notify(log_obj_id, notify_args);
+    }
+
+    return 1;
+
+drop:
+    if (q->dropped++ == 0) {
+        q->drop_pos = q->head;
+    }
+    xf_log_spin_unlock(&q->lock);
+    XF_LOG_STATS_ADD(log_obj_id, dropped, 1);
+
+    return 0;
+
+direct:
+    XF_LOG_STATS_ADD(log_obj_id, direct, 1);
+disabled:
+    xf_log_spin_unlock(&q->lock);
+
+    return -1;
+}
+
+static size_t xf_log_queue_drain(int log_obj_id)
+{
+    size_t count = 0;
+
+    // 同一时刻只允许一个上下文排空同一个后端
+    xf_log_queue_t *q = &s_log_obj[log_obj_id].queue;
+    uint8_t expected = 0;
+    if (!xf_log_atomic_cas(&q->draining, &expected, 1)) {
+        return 0;
+    }
+
+    while (1) {
+        xf_log_record_t *record = NULL;
+        uint32_t dropped = 0;
+
+        // 只在取出记录时持锁，渲染和 out_func 在锁外进行
+        xf_log_spin_lock(&q->lock);
+        if (q->dropped && (int32_t)(q->tail - q->drop_pos) >= 0) {
+            dropped = q->dropped;
+            q->dropped = 0;
+        } else if (q->head != q->tail) {
+            record = q->slot[q->tail % XF_LOG_QUEUE_SIZE];
+            xf_log_atomic_store(&q->tail, q->tail + 1);
+        }
+        xf_log_spin_unlock(&q->lock);
+
+        // 在丢弃发生的位置补上提示
+        if (dropped) {
+            xf_log_obj_printf(log_obj_id, XF_LOG_LVL_WARN, s_log_time_func ? s_log_time_func() : 0, "xf_log",
+                              XF_LOG_FILE, __LINE__, __func__, "%lu records dropped" XF_LOG_NEWLINE,
+                              (unsigned long)dropped);
+            continue;
+        }
+        if (record == NULL) {
+            break;
+        }
+
+        // 各后端按自己的配置渲染头部，正文共享
+        if (record->level == XF_LOG_LVL_NONE) {
+            XF_LOG_OBJ_OUT_FUNC(log_obj_id)(record->body, record->len, XF_LOG_OBJ_OUT_ARGS(log_obj_id));
+        } else {
+            xf_log_obj_printf(log_obj_id, record->level, record->time, record->tag, record->file, record->line,
+                              record->func, "%.*s", (int)record->len, record->body);
+        }
+        xf_log_record_release(record);
+        count++;
+    }
+
+    xf_log_atomic_store_release(&q->draining, 0);
+
+    return count;
+}
+
 #endif
+
+#if XF_LOG_SHARD_IS_ENABLE
+
+static uint32_t xf_log_shard_now(void)
+{
+    if (s_log_tick_func) {
+        return s_log_tick_func();
+    }
+    return s_log_time_func ? s_log_time_func() : 0;
+}
+
+static int xf_log_shard_push(uint32_t mask, uint8_t level, uint32_t time, const char *tag, const char *file,
+                             uint32_t line, const char *func, const char *fmt, va_list va, size_t *len)
+{
+    // 每个线程首次使用时分配一个分片，0 表示尚未分配
+    static XF_LOG_THREAD_LOCAL uint8_t s_shard = 0;
+    if (s_shard == 0) {
+        s_shard = xf_log_atomic_add(&s_log_shard_next, 1) % XF_LOG_SHARD_NUM + 1;
+    }
+    xf_log_shard_t *shard = &s_log_shard[s_shard - 1];
+
+    xf_log_spin_lock(&shard->lock);
+    uint32_t head = shard->head;
+    if (head - xf_log_atomic_load_acquire(&shard->tail) >= XF_LOG_SHARD_SLOT_NUM) {
+        xf_log_atomic_add(&shard->dropped, 1);
+        xf_log_spin_unlock(&shard->lock);
+        for (size_t i = 0; i < XF_LOG_OBJ_NUM; i++) {
+            if (mask & (1UL << i)) {
+                XF_LOG_STATS_ADD(i, dropped, 1);
+            }
+        }
+        return 0;
+    }
+
+    xf_log_shard_record_t *record = &shard->slot[head & (XF_LOG_SHARD_SLOT_NUM - 1)];
+    xf_log_cursor_t buf = {record->body, XF_LOG_RECORD_SIZE, 0};
+    xf_log_vprintf(xf_log_buf_out, &buf, fmt, va);
+    record->len = xf_log_buf_end(&buf, level != XF_LOG_LVL_NONE);
+    record->mask = mask;
+    record->level = level;
+    record->time = time;
+    record->tag = tag;
+    record->file = file;
+    record->line = line;
+    record->func = func;
+
+    // 格式化完成后才取时间戳，缩短取时间戳到提交之间的间隔，乱序窗口只需要覆盖这一段
+    record->stamp = xf_log_shard_now();
+    *len = record->len;
+    xf_log_atomic_store_release(&shard->head, head + 1);
+    xf_log_spin_unlock(&shard->lock);
+
+    return 1;
+}
+
+static void xf_log_shard_out(const xf_log_shard_record_t *record)
+{
+    XF_LOG_READ_LOCK(epoch);
+    const xf_log_active_t *active = XF_LOG_ACTIVE();
+    for (size_t k = 0; k < active->num; k++) {
+        size_t i = active->id[k];
+        if (!(record->mask & (1UL << i))) {
+            continue;
+        }
+        if (record->level == XF_LOG_LVL_NONE) {
+            XF_LOG_OBJ_OUT_FUNC(i)(record->body, record->len, XF_LOG_OBJ_OUT_ARGS(i));
+        } else {
+            xf_log_obj_printf(i, record->level, record->time, record->tag, record->file, record->line,
+                              record->func, "%.*s", (int)record->len, record->body);
+        }
+    }
+    XF_LOG_READ_UNLOCK(epoch);
+}
+
+static uint8_t xf_log_shard_lock(uint8_t wait)
+{
+    // 同一时刻只允许一个上下文合并，各分片的 tail 只由它修改
+    uint8_t expected = 0;
+    while (!xf_log_atomic_cas(&s_log_shard_merging, &expected, 1)) {
+        if (!wait) {
+            return 0;
+        }
+        expected = 0;
+        xf_log_yield();
+    }
+
+    return 1;
+}
+
+static size_t xf_log_shard_merge(uint8_t flush)
+{
+    size_t count = 0;
+
+    // 周期合并时其他上下文正在合并则直接返回，flush 需要等待它结束
+    if (!xf_log_shard_lock(flush)) {
+        return 0;
+    }
+
+    uint32_t now = xf_log_shard_now();
+    while (1) {
+        // 每个分片内部已经按时间戳有序，只需要比较各分片最旧的记录
+        xf_log_shard_t *oldest = NULL;
+        const xf_log_shard_record_t *record = NULL;
+        for (size_t s = 0; s < XF_LOG_SHARD_NUM; s++) {
+            xf_log_shard_t *shard = &s_log_shard[s];
+            if (shard->tail == xf_log_atomic_load_acquire(&shard->head)) {
+                continue;
+            }
+            const xf_log_shard_record_t *r = &shard->slot[shard->tail & (XF_LOG_SHARD_SLOT_NUM - 1)];
+            if (record == NULL || (int32_t)(r->stamp - record->stamp) < 0) {
+                oldest = shard;
+                record = r;
+            }
+        }
+
+        // 最旧的记录仍在乱序窗口内时，其他线程可能还会提交更早的记录
+        if (record == NULL || (!flush && (int32_t)(now - record->stamp) < (int32_t)s_log_shard_window)) {
+            break;
+        }
+
+        xf_log_shard_out(record);
+        xf_log_atomic_store_release(&oldest->tail, oldest->tail + 1);
+        count++;
+    }
+
+    // 汇总各分片的丢弃数，提示输出到所有分片后端
+    uint32_t dropped = 0;
+    for (size_t s = 0; s < XF_LOG_SHARD_NUM; s++) {
+        dropped += xf_log_atomic_load(&s_log_shard[s].dropped);
+    }
+    if (dropped != s_log_shard_reported) {
+        XF_LOG_READ_LOCK(epoch);
+        const xf_log_active_t *active = XF_LOG_ACTIVE();
+        for (size_t k = 0; k < active->num; k++) {
+            if (xf_log_atomic_load(&s_log_obj[active->id[k]].shard)) {
+                xf_log_obj_printf(active->id[k], XF_LOG_LVL_WARN, s_log_time_func ? s_log_time_func() : 0,
+                                  "xf_log", XF_LOG_FILE, __LINE__, __func__, "%lu records dropped" XF_LOG_NEWLINE,
+                                  (unsigned long)(dropped - s_log_shard_reported));
+            }
+        }
+        XF_LOG_READ_UNLOCK(epoch);
+        s_log_shard_reported = dropped;
+    }
+
+    xf_log_atomic_store_release(&s_log_shard_merging, 0);
+
+    return count;
+}
+
+static void xf_log_shard_stop(size_t log_obj_id, uint8_t forget)
+{
+    // 先停止写入分片，等读到旧标志的生产者提交完成后再把剩余的记录输出
+    xf_log_atomic_store_release(&s_log_obj[log_obj_id].shard, 0);
+#if XF_LOG_DYNAMIC_IS_ENABLE
+    xf_log_synchronize();
 #endif
+    xf_log_shard_merge(1);
+    if (!forget) {
+        return;
+    }
 
-    // 添加时间戳打印
-    if (s_log_time_func) {
-        len += xf_log_printf_out(out_func, user_args, "%c (%lu)-%s", s_lvl_to_prompt[level], s_log_time_func(), tag);
-    } else {
-        len += xf_log_printf_out(out_func, user_args, "%c %s", s_lvl_to_prompt[level], tag);
+    // 注销时清除仍留在分片中的记录对该 id 的标记，[tail, head) 之间的记录只有持有合并权的上下文访问
+    xf_log_shard_lock(1);
+    for (size_t s = 0; s < XF_LOG_SHARD_NUM; s++) {
+        xf_log_shard_t *shard = &s_log_shard[s];
+        uint32_t head = xf_log_atomic_load_acquire(&shard->head);
+        for (uint32_t k = shard->tail; k != head; k++) {
+            shard->slot[k & (XF_LOG_SHARD_SLOT_NUM - 1)].mask &= ~(1UL << log_obj_id);
+        }
     }
+    xf_log_atomic_store_release(&s_log_shard_merging, 0);
+}
 
-    // 打印信息
-    if (level <= s_log_obj[log_obj_id].info_level) {
-        len += xf_log_printf_out(out_func, user_args, "[%s:%lu(%s)]", file, line, func);
+#endif
+
+#if XF_LOG_STATS_IS_ENABLE || XF_LOG_LAYOUT_IS_ENABLE
+
+static size_t xf_log_utoa(char *buf, uint32_t val)
+{
+    char tmp[10];
+    size_t len = 0;
+
+    do {
+        tmp[len++] = '0' + val % 10;
+        val /= 10;
+    } while (val);
+
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = tmp[len - 1 - i];
     }
 
-    // 用户日志打印
-    len += xf_log_printf_out(out_func, user_args, ": ");
-    len += xf_log_vprintf(out_func, user_args, fmt, va);
+    return len;
+}
 
-#if XF_LOG_COLORS_IS_ENABLE
-#if XF_LOG_FILTER_IS_ENABLE
-    if (!s_log_obj[log_obj_id].filter.enable || (s_log_obj[log_obj_id].filter.enable
-            && s_log_obj[log_obj_id].filter.is_colorful)) {
 #endif
-        /* 清除 CSI 格式 */
-        if (s_lvl_to_color[level] != XF_LOG_COLOR_NULL) {
-            len += xf_log_printf_out(out_func, user_args, PL_CSI_END);
+
+#if XF_LOG_STATS_IS_ENABLE
+
+static xf_log_stats_t *xf_log_stats_get(int log_obj_id)
+{
+#if XF_LOG_STATS_SHARD_NUM > 1
+    // 每个线程首次使用时分配一个分片，0 表示尚未分配
+    static XF_LOG_THREAD_LOCAL uint8_t s_shard = 0;
+    if (s_shard == 0) {
+        s_shard = xf_log_atomic_add(&s_log_stats_shard_next, 1) % XF_LOG_STATS_SHARD_NUM + 1;
+    }
+    return &s_log_stats[s_shard - 1][log_obj_id];
+#else
+    return &s_log_stats[0][log_obj_id];
+#endif
+}
+
+static void xf_log_obj_out(const char *str, size_t len, void *arg)
+{
+    xf_log_obj_t *obj = (xf_log_obj_t *)arg;
+    xf_log_stats_t *stats = xf_log_stats_get(obj - s_log_obj);
+    xf_log_tick_func_t tick_func = s_log_tick_func;
+
+    if (tick_func) {
+        uint32_t start = tick_func();
+        obj->out_func(str, len, obj->user_args);
+        uint32_t ticks = tick_func() - start;
+        size_t bucket = 0;
+        while (ticks && bucket < XF_LOG_STATS_HIST_NUM - 1) {
+            ticks >>= 1;
+            bucket++;
         }
-#if XF_LOG_FILTER_IS_ENABLE
+        xf_log_atomic_add(&stats->out_hist[bucket], 1);
+    } else {
+        obj->out_func(str, len, obj->user_args);
+    }
+
+    xf_log_atomic_add(&stats->bytes, len);
+    xf_log_atomic_add(&stats->out_calls, 1);
+}
+
+static void xf_log_stats_dump_one(const char *name, int log_obj_id)
+{
+    xf_log_stats_t stats;
+    char hist[XF_LOG_STATS_HIST_NUM * 24];
+    size_t pos = 0;
+
+    xf_log_get_stats(log_obj_id, &stats);
+    // 报告直接调用 xf_log 输出，不经过调用点，不会计入调用点统计
+    xf_log(XF_LOG_LVL_INFO, "xf_log", XF_LOG_FILE, __LINE__, __func__,
+           "%s: emitted %lu, filtered %lu/%lu/%lu (level/tag/file), dropped %lu, direct %lu, bytes %lu, "
+           "out_calls %lu" XF_LOG_NEWLINE,
+           name, (unsigned long)stats.emitted, (unsigned long)stats.filtered_level,
+           (unsigned long)stats.filtered_tag, (unsigned long)stats.filtered_file,
+           (unsigned long)stats.dropped, (unsigned long)stats.direct, (unsigned long)stats.bytes,
+           (unsigned long)stats.out_calls);
+
+    // 只输出非空的桶，"<N:count" 表示耗时小于 N 个 tick 的调用次数
+    for (size_t i = 0; i < XF_LOG_STATS_HIST_NUM; i++) {
+        if (stats.out_hist[i] == 0) {
+            continue;
+        }
+        hist[pos++] = ' ';
+        if (i == XF_LOG_STATS_HIST_NUM - 1) {
+            hist[pos++] = '>';
+            hist[pos++] = '=';
+            pos += xf_log_utoa(&hist[pos], (uint32_t)1 << (i - 1));
+        } else {
+            hist[pos++] = '<';
+            pos += xf_log_utoa(&hist[pos], (uint32_t)1 << i);
+        }
+        hist[pos++] = ':';
+        pos += xf_log_utoa(&hist[pos], stats.out_hist[i]);
+    }
+    hist[pos] = '\0';
+
+    if (pos != 0) {
+        xf_log(XF_LOG_LVL_INFO, "xf_log", XF_LOG_FILE, __LINE__, __func__,
+               "%s: out_func ticks%s" XF_LOG_NEWLINE, name, hist);
+    }
+}
+
+static void xf_log_stats_poll(void)
+{
+    uint32_t period = s_log_stats_period;
+    if (period == 0 || s_log_time_func == NULL) {
+        return;
+    }
+
+    // 只有抢到更新权的线程负责输出，输出过程中的嵌套调用不会再次触发
+    uint32_t now = s_log_time_func();
+    uint32_t last = xf_log_atomic_load(&s_log_stats_last);
+    if (now - last < period || !xf_log_atomic_cas(&s_log_stats_last, &last, now)) {
+        return;
     }
+    xf_log_stats_dump(-1);
+}
+
 #endif
+
+#if XF_LOG_CALLSITE_IS_ENABLE
+
+static void xf_log_callsite_register(xf_log_callsite_t *callsite, const char *tag)
+{
+    // 只有抢到注册权的线程负责加入链表
+    uint8_t expected = 0;
+    if (!xf_log_atomic_cas(&callsite->registered, &expected, 1)) {
+        return;
+    }
+    callsite->tag = tag;
+
+    // 解析格式化字符串，片段超过 XF_LOG_CALLSITE_SPEC_NUM 时保持 spec_num 为 0，每次输出时解析
+    const char *p = callsite->fmt;
+    size_t num = 0;
+    for (; *p != '\0' && num < XF_LOG_CALLSITE_SPEC_NUM; num++) {
+        callsite->spec[num].pos = p - callsite->fmt;
+        p += xf_log_spec_parse(p, &callsite->spec[num]);
+    }
+    if (*p == '\0') {
+        xf_log_atomic_store_release(&callsite->spec_num, num);
+    }
+
+    xf_log_callsite_t *head = xf_log_atomic_load(&s_log_callsite_head);
+    do {
+        callsite->next = head;
+    } while (!xf_log_atomic_cas(&s_log_callsite_head, &head, callsite));
+
+    // 第一个调用点注册时开始第一个报告窗口
+    if (head == NULL && s_log_time_func) {
+        s_log_callsite_window_time = s_log_time_func();
+        s_log_callsite_window_valid = 1;
+    }
+}
+
+static void xf_log_callsite_poll(void)
+{
+    uint8_t expected = 1;
+    if (xf_log_atomic_load(&s_log_callsite_dump_pending)
+            && xf_log_atomic_cas(&s_log_callsite_dump_pending, &expected, 0)) {
+        xf_log_callsite_dump(0);
+    }
+}
+
 #endif
-    return len;
+
+#if XF_LOG_BUDGET_IS_ENABLE
+
+static void xf_log_budget_poll(void)
+{
+    uint32_t period = xf_log_atomic_load_acquire(&s_log_budget_period);
+    if (period == 0 || s_log_time_func == NULL) {
+        return;
+    }
+
+    // 只有抢到更新权的线程负责调整，调整时输出的记录不会再次触发
+    uint32_t now = s_log_time_func();
+    uint32_t last = xf_log_atomic_load(&s_log_budget_last);
+    if (now - last < period || !xf_log_atomic_cas(&s_log_budget_last, &last, now)) {
+        return;
+    }
+
+    uint32_t bytes = xf_log_atomic_load(&s_log_budget_bytes);
+    uint32_t records = xf_log_atomic_load(&s_log_budget_records);
+    uint32_t bytes_used = bytes - s_log_budget_bytes_base;
+    uint32_t records_used = records - s_log_budget_records_base;
+    s_log_budget_bytes_base = bytes;
+    s_log_budget_records_base = records;
+
+    // 窗口可能长于一个周期，按实际经过的时间折算成占预算的百分比，预算为 0 的一项不参与
+    uint32_t elapsed = now - last;
+    unsigned long long scale = (unsigned long long)period * 100;
+    unsigned long long used_pct = 0;
+    if (s_log_budget_bytes_limit) {
+        used_pct = bytes_used * scale / ((unsigned long long)s_log_budget_bytes_limit * elapsed);
+    }
+    if (s_log_budget_records_limit) {
+        unsigned long long pct = records_used * scale / ((unsigned long long)s_log_budget_records_limit * elapsed);
+        used_pct = pct > used_pct ? pct : used_pct;
+    }
+    uint8_t level = xf_log_atomic_load(&xf_log_gate_level);
+
+    if (used_pct > 100) {
+        s_log_budget_calm = 0;
+        if (level > XF_LOG_BUDGET_MIN_LEVEL) {
+            // 恢复之后又超出预算，说明负载还在，下次多等一倍的周期再恢复
+            if (s_log_budget_restored) {
+                s_log_budget_restored = 0;
+                s_log_budget_hold *= 2;
+                if (s_log_budget_hold > XF_LOG_BUDGET_HOLD_MAX) {
+                    s_log_budget_hold = XF_LOG_BUDGET_HOLD_MAX;
+                }
+            }
+            xf_log_budget_step(level - 1, bytes_used, records_used, elapsed);
+        }
+        return;
+    }
+
+    if (used_pct > XF_LOG_BUDGET_RESTORE_PERCENT) {
+        s_log_budget_calm = 0;
+        return;
+    }
+    if (++s_log_budget_calm < s_log_budget_hold) {
+        return;
+    }
+    s_log_budget_calm = 0;
+    if (level < s_log_budget_level) {
+        s_log_budget_restored = 1;
+        xf_log_budget_step(level + 1, bytes_used, records_used, elapsed);
+    } else {
+        // 在设置的等级上平稳了一段时间，退避清零
+        s_log_budget_hold = XF_LOG_BUDGET_HOLD_NUM;
+        s_log_budget_restored = 0;
+    }
+}
+
+static void xf_log_budget_step(uint8_t level, uint32_t bytes, uint32_t records, uint32_t elapsed)
+{
+    uint8_t prev = xf_log_atomic_load(&xf_log_gate_level);
+    xf_log_atomic_store(&xf_log_gate_level, level);
+
+    // 直接调用 xf_log，标记记录不受运行时等级屏蔽
+    xf_log(level < prev ? XF_LOG_LVL_WARN : XF_LOG_LVL_INFO, "xf_log", XF_LOG_FILE, __LINE__, __func__,
+           "log budget %s: %lu bytes, %lu records in %lu, level %c -> %c" XF_LOG_NEWLINE,
+           level < prev ? "exceeded" : "recovered", (unsigned long)bytes, (unsigned long)records,
+           (unsigned long)elapsed, s_lvl_to_prompt[prev], s_lvl_to_prompt[level]);
 }
+
+#endif
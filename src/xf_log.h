@@ -33,6 +33,7 @@
 /* ==================== [Includes] ========================================== */
 
 #include "xf_log_config_internel.h"
+#include <stdarg.h>
 
 #if XF_LOG_STDDEF_IS_ENABLE
 #include <stddef.h>
@@ -68,6 +69,12 @@ extern "C" {
 #define XF_LOG_LVL_DEBUG    (5)
 #define XF_LOG_LVL_VERBOSE  (6)
 
+#define XF_LOG_WAIT_FOREVER (0xFFFFFFFFUL)
+
+#if XF_LOG_ISR_IS_ENABLE
+#define XF_LOG_ISR_ARG_NUM  (6)     /*!< 中断/信号上下文中单条记录最多携带的参数个数 */
+#endif
+
 /**
  * End of addtogroup group_xf_log
  * @}
@@ -98,17 +105,269 @@ typedef void (*xf_log_out_t)(const char *str, size_t len, void *arg);
  */
 typedef uint32_t (*xf_log_time_func_t)(void);
 
+/**
+ * @brief log 高精度计时原型，用于统计 out_func 耗时等场景。
+ *
+ * @return 单调递增的计数值（如 CPU 周期数、微秒数），允许回绕。
+ */
+typedef uint32_t (*xf_log_tick_func_t)(void);
+
+/**
+ * @brief 格式化到调用者缓冲区时的写入位置，见 @ref xf_log_cursor_init.
+ */
+typedef struct _xf_log_cursor_t {
+    char *data;                 /*!< 调用者提供的缓冲区 */
+    size_t size;                /*!< 缓冲区的大小 */
+    size_t len;                 /*!< 期望写入的总长度，可能大于 size，超出部分被截断 */
+} xf_log_cursor_t;
+
+#if XF_LOG_ASYNC_IS_ENABLE
+
+/**
+ * @brief log 异步后端队列满时的处理策略。
+ */
+typedef enum _xf_log_policy_t {
+    XF_LOG_POLICY_BLOCK = 0,            /*!< 阻塞等待队列有空间，超时后丢弃新记录 */
+    XF_LOG_POLICY_DROP_NEWEST,          /*!< 直接丢弃新记录 */
+    XF_LOG_POLICY_DROP_OLDEST,          /*!< 丢弃最旧的记录腾出空间 */
+    XF_LOG_POLICY_BY_LEVEL,             /*!< 按等级丢弃，DEBUG 及以下最先丢弃，ERROR 及以上挤掉最旧的低等级记录，
+                                             没有可挤掉的记录时等待，超时后在调用者上下文中直接输出 */
+} xf_log_policy_t;
+
+/**
+ * @brief log 异步后端有新记录时的通知原型，一般用于唤醒该后端的输出任务。
+ *
+ * @param log_obj_id 有新记录的log对象id
+ * @param arg 用户参数，见 @ref xf_log_set_async_notify.
+ */
+typedef void (*xf_log_notify_t)(int log_obj_id, void *arg);
+
+#endif
+
+#if XF_LOG_LINE_OUT_IS_ENABLE
+
+/**
+ * @brief 整行输出时当前记录的信息，见 @ref xf_log_get_line_info.
+ */
+typedef struct _xf_log_line_info_t {
+    uint8_t level;              /*!< 记录的等级 */
+    uint32_t time;              /*!< 记录产生时的时间戳 */
+    const char *tag;            /*!< 记录的标签 */
+    const char *file;           /*!< 记录所在文件 */
+    uint32_t line;              /*!< 记录所在行数 */
+    const char *func;           /*!< 记录所在函数 */
+    const char *fmt;            /*!< 正文的格式化字符串，后端可以用 xf_log_vsnprintf 单独格式化正文 */
+    va_list *va;                /*!< 正文的参数，使用前需要 va_copy */
+} xf_log_line_info_t;
+
+#endif
+
+#if XF_LOG_STATS_IS_ENABLE
+
+/**
+ * @brief log 统计计数。
+ */
+typedef struct _xf_log_stats_t {
+    uint32_t emitted;           /*!< 交由后端输出的记录数 */
+    uint32_t filtered_level;    /*!< 被等级过滤的记录数 */
+    uint32_t filtered_tag;      /*!< 被标签过滤的记录数 */
+    uint32_t filtered_file;     /*!< 被文件过滤的记录数 */
+    uint32_t dropped;           /*!< 被丢弃或抑制的记录数 */
+    uint32_t direct;            /*!< 异步队列等待超时后改为直接输出的记录数 */
+    uint32_t bytes;             /*!< 写出的字节数 */
+    uint32_t out_calls;         /*!< out_func 调用次数 */
+    uint32_t out_hist[XF_LOG_STATS_HIST_NUM]; /*!< out_func 耗时直方图，按 2 的幂划分，需设置 tick 函数 */
+} xf_log_stats_t;
+
+#endif
+
+/**
+ * @brief 格式化字符串解析后的片段，一段文本或者一个格式控制符。
+ */
+typedef struct _xf_log_spec_t {
+    uint32_t pos;                       /*!< 片段在格式化字符串中的偏移 */
+    uint8_t len;                        /*!< 片段的长度，格式控制符包含 % */
+    uint8_t type;                       /*!< 片段的类型 */
+    uint8_t arg;                        /*!< 消耗的参数类型，高 4 位为 '*' 的个数 */
+} xf_log_spec_t;
+
+#if XF_LOG_CALLSITE_IS_ENABLE
+
+/**
+ * @brief log 调用点，由 xf_log_level 在每个调用位置静态定义。
+ */
+typedef struct _xf_log_callsite_t {
+    const char *file;                   /*!< 调用点所在文件 */
+    const char *func;                   /*!< 调用点所在函数 */
+    const char *fmt;                    /*!< 调用点的格式化字符串，不含换行 */
+    uint32_t line;                      /*!< 调用点所在行数 */
+    const char *tag;                    /*!< 调用点的标签，首次调用时记录 */
+    uint32_t hits;                      /*!< 命中次数 */
+    uint32_t bytes;                     /*!< 产生的字节数 */
+    uint32_t filtered;                  /*!< 被所有后端过滤掉的次数 */
+    uint32_t window_hits;               /*!< 上次报告时的命中次数，用于计算报告窗口内的速率 */
+    uint8_t registered;                 /*!< 是否已加入调用点链表 */
+    struct _xf_log_callsite_t *next;    /*!< 调用点链表 */
+    uint8_t spec_num;                   /*!< 格式化字符串解析后的片段数，为 0 表示未解析 */
+    xf_log_spec_t spec[XF_LOG_CALLSITE_SPEC_NUM]; /*!< 首次调用时解析，之后格式化时不再解析 */
+} xf_log_callsite_t;
+
+#define XF_LOG_CALLSITE_INIT(_fmt) { XF_LOG_FILE, __func__, _fmt, __LINE__, NULL, 0, 0, 0, 0, 0, NULL, 0, {{0}} }
+
+#endif
+
+#if XF_LOG_ISR_IS_ENABLE
+
+/**
+ * @brief 中断/信号上下文的调用点，由 xf_log_isr_level 在每个调用位置静态定义。
+ */
+typedef struct _xf_log_isr_site_t {
+    const char *file;                   /*!< 调用点所在文件 */
+    const char *func;                   /*!< 调用点所在函数 */
+    const char *fmt;                    /*!< 调用点的格式化字符串 */
+    uint32_t line;                      /*!< 调用点所在行数 */
+    uint8_t level;                      /*!< 调用点的等级 */
+} xf_log_isr_site_t;
+
+#endif
+
 /* ==================== [Global Prototypes] ================================= */
 
 /**
  * @brief 注册log后端是输出到哪里，其最大值受到 XF_LOG_OBJ_MAX 的限制
  *
+ * 开启 XF_LOG_DYNAMIC_ENABLE 时可以在其他线程输出log的同时调用，函数会等待正在输出的调用结束，
+ * 因此不能在 out_func、notify 回调或者其他正在输出log的上下文中调用。
+ *
  * @param out_func 后端输出函数， 如果减少IO操作，可以考虑使用异步缓冲
  * @param user_args 传入的参数，会在 out_func 中被调用
  * @return int  -1:失败, >=0:注册成功后返回的id
  */
 int xf_log_register_obj(xf_log_out_t out_func, void *user_args);
 
+#if XF_LOG_DYNAMIC_IS_ENABLE
+
+/**
+ * @brief 注销log后端，可以在其他线程输出log的同时调用
+ *
+ * 后端先从活动列表中移除，等待所有正在使用它的调用结束后，再输出异步队列中剩余的记录并释放该id。
+ * 函数返回后 out_func 不会再被调用，id 可能被之后注册的后端复用。
+ * 不能在 out_func 或者 notify 回调中调用。
+ *
+ * @param log_obj_id 指定log对象id
+ * @return int  -1:失败, 0:成功
+ */
+int xf_log_unregister_obj(int log_obj_id);
+
+#endif
+
+#if XF_LOG_ASYNC_IS_ENABLE
+
+/**
+ * @brief 将log后端设置为异步输出，设置后 out_func 只在 xf_log_flush 中被调用
+ *
+ * 每个异步后端拥有独立的队列，正文只格式化一次并由各队列共享，头部在输出时按后端各自的配置生成。
+ * 丢弃的记录会被统计，并在输出到丢弃位置时插入 "N records dropped" 提示。
+ *
+ * @param log_obj_id 指定log对象id
+ * @param policy 队列满时的处理策略
+ * @param timeout XF_LOG_POLICY_BLOCK、XF_LOG_POLICY_BY_LEVEL 阻塞等待的超时时间，单位与时间戳函数一致，
+ *                XF_LOG_WAIT_FOREVER 表示一直等待，0 表示不等待；未设置时间戳函数时 BLOCK 只能是这两者之一，否则返回失败。
+ *                打印log的上下文同时负责排空时（单线程中调用 xf_log_flush，或者在 out_func、notify 中打印）
+ *                不要使用 XF_LOG_WAIT_FOREVER，否则队列满时会一直等待
+ * @return int  -1:失败, 0:成功
+ */
+int xf_log_set_async_enable(int log_obj_id, xf_log_policy_t policy, uint32_t timeout);
+
+/**
+ * @brief 将log后端恢复为同步输出，队列中剩余的记录会先被输出
+ *
+ * 正在入队或者阻塞等待的记录改为在调用者上下文中直接输出，不会丢失。
+ * 函数会等待正在进行的排空结束，不能在 out_func 或者 notify 回调中调用。
+ *
+ * @param log_obj_id 指定log对象id
+ * @return int  -1:失败, 0:成功
+ */
+int xf_log_set_async_disable(int log_obj_id);
+
+/**
+ * @brief 设置异步后端有新记录时的通知，可用于唤醒该后端专属的输出任务
+ *
+ * @param log_obj_id 指定log对象id
+ * @param notify 通知函数，在打印log的上下文中调用，为 NULL 则不通知
+ * @param user_args 传入的参数，会在 notify 中被调用
+ */
+void xf_log_set_async_notify(int log_obj_id, xf_log_notify_t notify, void *user_args);
+
+/**
+ * @brief 排空异步后端的队列，一般在该后端专属的输出任务中调用
+ *
+ * 不同后端可以在不同的上下文中排空，慢速后端不会拖慢其他后端。
+ *
+ * @param log_obj_id 指定log对象id，为 -1 时排空所有log对象
+ * @return size_t 输出的记录数
+ */
+size_t xf_log_flush(int log_obj_id);
+
+#endif
+
+#if XF_LOG_SHARD_IS_ENABLE
+
+/**
+ * @brief 将log后端设置为分片缓冲输出，设置后 out_func 只在 xf_log_shard_process 中被调用
+ *
+ * 每个线程把记录写入自己的分片，生产者之间不竞争同一个队列。
+ * 记录带有时间戳（优先使用 tick 函数），合并时按时间戳从各分片中依次取出，整体保持先后顺序。
+ * 分片满时丢弃新记录，并在合并时插入 "N records dropped" 提示。
+ *
+ * @param log_obj_id 指定log对象id
+ * @return int  -1:失败, 0:成功
+ */
+int xf_log_set_shard_enable(int log_obj_id);
+
+/**
+ * @brief 将log后端恢复为直接输出，分片中剩余的记录会先被输出
+ *
+ * 开启 XF_LOG_DYNAMIC_ENABLE 时会等待正在写入分片的调用结束，之后再合并，返回时该后端的记录都已输出；
+ * 否则需要调用者保证此时没有其他线程正在输出log。
+ * 不能在 out_func 中调用。
+ *
+ * @param log_obj_id 指定log对象id
+ * @return int  -1:失败, 0:成功
+ */
+int xf_log_set_shard_disable(int log_obj_id);
+
+/**
+ * @brief 设置合并时的乱序窗口
+ *
+ * 合并时只输出早于当前时间 window 的记录，晚于此的记录等待下一次合并，
+ * 其他线程在此期间写入的更早的记录仍能排在它前面。
+ * 窗口应大于一个线程从取时间戳到提交记录之间可能被打断的时长。
+ *
+ * @param window 乱序窗口，单位与 tick 函数一致，未设置 tick 函数时与时间戳函数一致，默认 0
+ */
+void xf_log_set_shard_window(uint32_t window);
+
+/**
+ * @brief 合并各分片中超出乱序窗口的记录并输出，一般在专属的输出任务中周期调用
+ *
+ * 同一时刻只有一个上下文进行合并，其他上下文调用时直接返回 0。
+ *
+ * @return size_t 输出的记录数
+ */
+size_t xf_log_shard_process(void);
+
+/**
+ * @brief 忽略乱序窗口，合并并输出各分片中的所有记录，一般在退出前调用
+ *
+ * 其他上下文正在合并时等待其结束后再合并，因此不能在 out_func 中调用。
+ *
+ * @return size_t 输出的记录数
+ */
+size_t xf_log_shard_flush(void);
+
+#endif
+
 /**
  * End of addtogroup group_xf_log_port
  * @}
@@ -199,6 +458,59 @@ void xf_log_set_filter_file(int log_obj_id, const char *file);
  */
 void xf_log_set_info_level(int log_obj_id, uint8_t level);
 
+#if XF_LOG_LINE_OUT_IS_ENABLE
+
+/**
+ * @brief 开启整行输出，每条记录先在栈上格式化完整，再调用一次 out_func
+ *
+ * 适用于以记录为单位的后端（共享内存、数据报套接字、多进程追加写文件等），
+ * 超过 XF_LOG_LINE_SIZE 的记录会被截断并保留结尾的换行。
+ *
+ * @param log_obj_id 指定log对象id
+ */
+void xf_log_set_line_out_enable(int log_obj_id);
+
+/**
+ * @brief 关闭整行输出，恢复分段调用 out_func
+ *
+ * @param log_obj_id 指定log对象id
+ */
+void xf_log_set_line_out_disable(int log_obj_id);
+
+/**
+ * @brief 获取当前正在输出的记录的信息，只能在整行输出的 out_func 中调用
+ *
+ * @return const xf_log_line_info_t* 当前记录的信息，xf_log_printf 的输出返回 NULL
+ */
+const xf_log_line_info_t *xf_log_get_line_info(void);
+
+#endif
+
+#if XF_LOG_LAYOUT_IS_ENABLE
+
+/**
+ * @brief 设置log后端的行格式，格式在设置时被编译，输出时不再解析
+ *
+ * 支持的字段：
+ * - %T 时间戳，%L 等级字符，%t tag，%f 文件名，%l 行号，%F 函数名，%m 用户日志
+ * - %C 等级对应的颜色，%R 清除颜色，关闭彩色打印时二者不输出任何内容
+ * - %[ ... %] 仅当等级满足 xf_log_set_info_level 时才输出其中的内容，不支持嵌套
+ * - %% 输出 %
+ *
+ * 例如 "%C%L (%T)-%t%[[%f:%l(%F)]%]: %m%R" 与默认格式相同。
+ *
+ * 开启 XF_LOG_DYNAMIC_ENABLE 时可以在其他线程输出log的同时调用，新格式整体生效，
+ * 函数会等待仍在使用旧格式的输出结束，不能在 out_func 或者 notify 回调中调用；
+ * 未开启时只能在该后端开始输出之前调用。
+ *
+ * @param log_obj_id 指定log对象id
+ * @param pattern 格式字符串，需要一直有效，不超过 255 个字符，为NULL时恢复默认格式
+ * @return int  -1:失败, 0:成功
+ */
+int xf_log_set_layout(int log_obj_id, const char *pattern);
+
+#endif
+
 /**
  * @brief 设置log的时间戳打印函数
  *
@@ -206,6 +518,75 @@ void xf_log_set_info_level(int log_obj_id, uint8_t level);
  */
 void xf_log_set_time_func(xf_log_time_func_t log_time_func);
 
+/**
+ * @brief 设置log的高精度计时函数
+ *
+ * @param log_tick_func log的高精度计时函数，为 NULL 则不统计耗时
+ */
+void xf_log_set_tick_func(xf_log_tick_func_t log_tick_func);
+
+#if XF_LOG_STATS_IS_ENABLE
+
+/**
+ * @brief 获取统计计数，读取时汇总各分片的计数
+ *
+ * @param log_obj_id 指定log对象id，为 -1 时汇总所有log对象
+ * @param stats 统计计数的输出
+ * @return int  -1:失败, 0:成功
+ */
+int xf_log_get_stats(int log_obj_id, xf_log_stats_t *stats);
+
+/**
+ * @brief 通过log自身输出统计计数
+ *
+ * @param log_obj_id 指定log对象id，为 -1 时输出所有log对象
+ */
+void xf_log_stats_dump(int log_obj_id);
+
+/**
+ * @brief 设置统计计数的周期输出
+ *
+ * @param period 输出周期，单位与时间戳函数一致，为 0 则关闭周期输出
+ */
+void xf_log_set_stats_dump_period(uint32_t period);
+
+#endif
+
+#if XF_LOG_BUDGET_IS_ENABLE
+
+/**
+ * @brief 设置所有后端合计的输出预算
+ *
+ * 每个周期统计交给各后端的记录数和字节数，超出预算时运行时等级降低一级（VERBOSE -> DEBUG -> INFO），
+ * 字节数按各后端实际收到的内容计算，异步和分片的后端在记录取出输出时计入，被丢弃的记录不计入。
+ * 最低降到 XF_LOG_BUDGET_MIN_LEVEL；负载回落后逐级恢复到 xf_log_set_level 设置的等级。
+ * 恢复后又超出预算时，下一次恢复前等待的周期数加倍（最多 XF_LOG_BUDGET_HOLD_MAX），
+ * 在设置的等级上平稳之后再回到 XF_LOG_BUDGET_HOLD_NUM。
+ * 每次调整等级都会输出一条 tag 为 "xf_log" 的记录。
+ * 被运行时等级屏蔽的 XF_LOGx 在调用处直接跳过，不求值参数，也不进入 xf_log。
+ *
+ * @param bytes 每个周期的字节数预算，为 0 则不限制
+ * @param records 每个周期的记录数预算，为 0 则不限制
+ * @param period 统计周期，单位与时间戳函数一致，为 0 则关闭预算并恢复等级
+ */
+void xf_log_set_budget(uint32_t bytes, uint32_t records, uint32_t period);
+
+/**
+ * @brief 设置运行时等级，高于此等级的 XF_LOGx 在调用处跳过
+ *
+ * @param level 运行时等级，默认 XF_LOG_LVL_VERBOSE
+ */
+void xf_log_set_level(uint8_t level);
+
+/**
+ * @brief 获取当前生效的运行时等级，超出预算时低于 xf_log_set_level 设置的等级
+ *
+ * @return uint8_t 当前生效的运行时等级
+ */
+uint8_t xf_log_get_level(void);
+
+#endif
+
 /**
  * @brief log打印函数
  *
@@ -218,7 +599,8 @@ void xf_log_set_time_func(xf_log_time_func_t log_time_func);
  * @param ...
  * @return size_t 格式化输出的长度
  */
-size_t xf_log(uint8_t level, const char *tag, const char *file, uint32_t line, const char *func, const char *fmt, ...);
+size_t xf_log(uint8_t level, const char *tag, const char *file, uint32_t line, const char *func, const char *fmt, ...)
+XF_LOG_PRINTF_ATTR(6, 7);
 
 /**
  * @brief 朴实无华的打印函数
@@ -227,11 +609,240 @@ size_t xf_log(uint8_t level, const char *tag, const char *file, uint32_t line, c
  * @param ... 需要格式化的参数
  * @return size_t 格式化打印的长度
  */
-size_t xf_log_printf(const char *format, ...);
+size_t xf_log_printf(const char *format, ...) XF_LOG_PRINTF_ATTR(1, 2);
+
+/**
+ * @brief 使用 xf_log 的格式化引擎格式化到调用者的缓冲区，行为与 snprintf 相同
+ *
+ * @param buf 输出缓冲区，为 NULL 时只计算长度
+ * @param size 缓冲区的大小，包含结尾的 '\0'
+ * @param format 需要格式化打印的字符串
+ * @param ... 需要格式化的参数
+ * @return size_t 完整格式化所需的长度（不含 '\0'），大于等于 size 表示被截断
+ */
+size_t xf_log_snprintf(char *buf, size_t size, const char *format, ...) XF_LOG_PRINTF_ATTR(3, 4);
+
+/**
+ * @brief xf_log_snprintf 的 va_list 版本
+ *
+ * @param buf 输出缓冲区，为 NULL 时只计算长度
+ * @param size 缓冲区的大小，包含结尾的 '\0'
+ * @param format 需要格式化打印的字符串
+ * @param va 需要格式化的参数
+ * @return size_t 完整格式化所需的长度（不含 '\0'），大于等于 size 表示被截断
+ */
+size_t xf_log_vsnprintf(char *buf, size_t size, const char *format, va_list va) XF_LOG_PRINTF_ATTR(3, 0);
+
+/**
+ * @brief 初始化写入位置，之后可以分多次追加内容，直接写入调用者的缓冲区而不经过中间拷贝
+ *
+ * @param cursor 写入位置
+ * @param buf 输出缓冲区，为 NULL 时只计算长度
+ * @param size 缓冲区的大小
+ */
+void xf_log_cursor_init(xf_log_cursor_t *cursor, char *buf, size_t size);
+
+/**
+ * @brief 在写入位置追加一段原样的内容
+ *
+ * @param cursor 写入位置
+ * @param str 追加的内容
+ * @param len 追加的长度
+ * @return size_t 追加的长度
+ */
+size_t xf_log_cursor_write(xf_log_cursor_t *cursor, const char *str, size_t len);
+
+/**
+ * @brief 在写入位置追加格式化的内容
+ *
+ * @param cursor 写入位置
+ * @param format 需要格式化打印的字符串
+ * @param ... 需要格式化的参数
+ * @return size_t 本次格式化的完整长度
+ */
+size_t xf_log_cursor_printf(xf_log_cursor_t *cursor, const char *format, ...) XF_LOG_PRINTF_ATTR(2, 3);
+
+/**
+ * @brief xf_log_cursor_printf 的 va_list 版本
+ *
+ * @param cursor 写入位置
+ * @param format 需要格式化打印的字符串
+ * @param va 需要格式化的参数
+ * @return size_t 本次格式化的完整长度
+ */
+size_t xf_log_cursor_vprintf(xf_log_cursor_t *cursor, const char *format, va_list va) XF_LOG_PRINTF_ATTR(2, 0);
+
+/**
+ * @brief 结束写入，在缓冲区中补上结尾的 '\0'
+ *
+ * 不需要 '\0' 时（如数据报、共享内存槽位）可以不调用，直接使用 cursor->len 与 cursor->size 中较小的一个作为长度。
+ *
+ * @param cursor 写入位置
+ * @return size_t 完整内容所需的长度（不含 '\0'），大于等于 size 表示被截断
+ */
+size_t xf_log_cursor_end(xf_log_cursor_t *cursor);
+
+#if XF_LOG_HEX_IS_ENABLE
+
+/**
+ * @brief 以紧凑的十六进制输出二进制缓冲区，每行 XF_LOG_HEX_LINE_WIDTH 个字节，一般通过 XF_LOG_BUFFER_HEX 调用
+ *
+ * 先检查是否有后端会输出该等级、标签、文件的记录，都被过滤时不做任何转换。
+ * 每一行作为一条独立的记录输出，如 "000102030405060708090a0b0c0d0e0f"。
+ *
+ * @param level log打印等级
+ * @param tag 打印标签
+ * @param file 当前文件
+ * @param line 当前行数
+ * @param func 当前函数
+ * @param buf 二进制缓冲区
+ * @param len 缓冲区的字节数
+ * @return size_t 格式化输出的总长度
+ */
+size_t xf_log_buffer_hex(uint8_t level, const char *tag, const char *file, uint32_t line, const char *func,
+                         const void *buf, size_t len);
+
+/**
+ * @brief 以偏移、十六进制和 ASCII 三栏的格式输出二进制缓冲区，一般通过 XF_LOG_BUFFER_HEXDUMP 调用
+ *
+ * 过滤规则与 xf_log_buffer_hex 相同，每一行作为一条独立的记录输出，如
+ * "00000010  10 11 12 13 14 15 16 17  18 19 1a 1b 1c 1d 1e 1f  |................|"。
+ *
+ * @param level log打印等级
+ * @param tag 打印标签
+ * @param file 当前文件
+ * @param line 当前行数
+ * @param func 当前函数
+ * @param buf 二进制缓冲区
+ * @param len 缓冲区的字节数
+ * @return size_t 格式化输出的总长度
+ */
+size_t xf_log_buffer_hexdump(uint8_t level, const char *tag, const char *file, uint32_t line, const char *func,
+                             const void *buf, size_t len);
+
+#endif
+
+#if XF_LOG_CALLSITE_IS_ENABLE
+
+/**
+ * @brief 带调用点统计的log打印函数，一般通过 xf_log_level 调用
+ *
+ * @param callsite 调用点
+ * @param level log打印等级
+ * @param tag 打印标签
+ * @param ...
+ * @return size_t 格式化输出的长度
+ */
+size_t xf_log_callsite(xf_log_callsite_t *callsite, uint8_t level, const char *tag, ...);
+
+/**
+ * @brief 获取报告窗口内命中次数最多的调用点
+ *
+ * @param top 调用点的输出数组，按命中次数从多到少排列
+ * @param num 输出数组的大小
+ * @return size_t 实际输出的调用点个数
+ */
+size_t xf_log_callsite_top(xf_log_callsite_t **top, size_t num);
+
+/**
+ * @brief 通过log自身输出命中次数最多的调用点，并开启新的报告窗口
+ *
+ * 窗口开始时已经设置时间戳函数时，同时输出窗口时长以及每 1000 个时间单位（tick）的命中次数。
+ * 报告直接通过 xf_log 输出，不计入调用点统计。
+ *
+ * @param num 输出的调用点个数，为 0 则使用 XF_LOG_CALLSITE_TOP_NUM
+ */
+void xf_log_callsite_dump(size_t num);
+
+/**
+ * @brief 请求输出调用点报告，报告在下一次打印log时输出。
+ *
+ * 该函数是异步信号安全的，可以在信号处理函数中调用。
+ */
+void xf_log_callsite_dump_request(void);
+
+#endif
+
+#if XF_LOG_ISR_IS_ENABLE
+
+/**
+ * @brief 中断/信号上下文的log打印函数，一般通过 xf_log_isr_level 调用
+ *
+ * 只把调用点、标签和原始参数写入预先分配的无锁槽位，不格式化、不加锁、不调用时间戳函数和 out_func，
+ * 可以在中断、信号处理函数（包括崩溃处理）中调用。记录由 xf_log_isr_process 在普通上下文中格式化输出。
+ * 槽位用尽时丢弃该记录，丢弃的记录数在下一次 xf_log_isr_process 时输出。
+ *
+ * 参数按调用点格式化字符串中对应的格式控制符的类型读取并连同类型一起保存，输出时再按原类型格式化，
+ * 宽度和精度中的 '*' 也各占一个参数。%s 对应的字符串需要在输出之前一直有效（如字符串常量），
+ * 输出的正文超出 XF_LOG_LINE_SIZE 时被截断。
+ *
+ * @param site 调用点
+ * @param tag 打印标签，需要在输出之前一直有效
+ * @param num 参数个数，不超过 XF_LOG_ISR_ARG_NUM
+ * @param ... 与调用点格式化字符串匹配的参数
+ * @return int  -1:槽位用尽被丢弃, 0:成功
+ */
+int xf_log_isr(const xf_log_isr_site_t *site, const char *tag, uint8_t num, ...);
+
+/**
+ * @brief 输出中断/信号上下文中记录的log，需要在普通上下文中周期调用
+ *
+ * 记录按写入的顺序经过 xf_log 输出，时间戳为输出时的时间。不能同时在多个上下文中调用。
+ *
+ * @return size_t 输出的记录数
+ */
+size_t xf_log_isr_process(void);
+
+#endif
 
 /* ==================== [Macros] ============================================ */
 
-#define xf_log_level(level, tag, fmt, ...)  xf_log(level, tag, __FILE__, __LINE__, __func__, fmt XF_LOG_NEWLINE, ##__VA_ARGS__)
+/**
+ * @brief 只用于编译期检查格式化字符串与参数是否匹配，不会被调用
+ */
+static inline XF_LOG_PRINTF_ATTR(1, 2) void xf_log_format_check(const char *fmt, ...)
+{
+    (void)fmt;
+}
+
+#if XF_LOG_BUDGET_IS_ENABLE
+// 当前生效的运行时等级，只由 xf_log.c 修改，调用处直接读取
+extern uint8_t xf_log_gate_level;
+#define XF_LOG_GATE(level)  ((level) <= xf_log_atomic_load(&xf_log_gate_level))
+#else
+#define XF_LOG_GATE(level)  (1)
+#endif
+
+#if XF_LOG_CALLSITE_IS_ENABLE
+#define xf_log_level(level, tag, fmt, ...)  __extension__({                                         \
+        static xf_log_callsite_t _xf_log_callsite = XF_LOG_CALLSITE_INIT(fmt XF_LOG_NEWLINE);      \
+        if (0) {                                                                                    \
+            xf_log_format_check(fmt, ##__VA_ARGS__);                                                \
+        }                                                                                           \
+        XF_LOG_GATE(level) ? xf_log_callsite(&_xf_log_callsite, level, tag, ##__VA_ARGS__) : 0;     \
+    })
+#else
+#define xf_log_level(level, tag, fmt, ...)  (XF_LOG_GATE(level)                                     \
+        ? xf_log(level, tag, XF_LOG_FILE, __LINE__, __func__, fmt XF_LOG_NEWLINE, ##__VA_ARGS__) : 0)
+#endif
+
+#if XF_LOG_ISR_IS_ENABLE
+#define XF_LOG_ISR_PICK(_0, _1, _2, _3, _4, _5, _6, _7, x, ...)    x
+#define XF_LOG_ISR_NARG(...)    XF_LOG_ISR_PICK(_0, ##__VA_ARGS__, XF_LOG_ISR_TOO_MANY_ARGS, 6, 5, 4, 3, 2, 1, 0)
+
+// 参数原样传入，由 xf_log_isr 按格式控制符的类型读取，超过 XF_LOG_ISR_ARG_NUM 个参数时编译报错
+#define xf_log_isr_level(level, tag, fmt, ...)  do {                                                \
+        static const xf_log_isr_site_t _xf_log_isr_site = {                                         \
+            XF_LOG_FILE, __func__, fmt, __LINE__, level                                             \
+        };                                                                                          \
+        if (0) {                                                                                    \
+            xf_log_format_check(fmt, ##__VA_ARGS__);                                                \
+        }                                                                                           \
+        if (XF_LOG_GATE(level)) {                                                                   \
+            xf_log_isr(&_xf_log_isr_site, tag, XF_LOG_ISR_NARG(__VA_ARGS__), ##__VA_ARGS__);        \
+        }                                                                                           \
+    } while (0)
+#endif
 
 /**
  * End of addtogroup group_xf_log
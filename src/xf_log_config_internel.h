@@ -79,6 +79,22 @@ extern "C" {
 #error "xf_log_vsprintf(buffer, maxlen, fmt, args) must be defined when XF_LOG_VSNPRINTF_IS_ENABLE is 0"
 #endif
 
+// 记录中的文件信息，默认为 __FILE__ 完整路径
+// XF_LOG_FILE_BASENAME_ENABLE 为 1 时只保留文件名，需要编译器支持 __FILE_NAME__（GCC 12、Clang 9 及以上）
+// 构建系统为每个源文件定义 XF_LOG_FILE_ID 时只输出 "#编号"，由 tools/xf_log_file_map 还原为路径
+#define XF_LOG_STRINGIFY(x) #x
+#define XF_LOG_TOSTRING(x) XF_LOG_STRINGIFY(x)
+
+#ifndef XF_LOG_FILE
+#if defined(XF_LOG_FILE_ID)
+#define XF_LOG_FILE "#" XF_LOG_TOSTRING(XF_LOG_FILE_ID)
+#elif defined(XF_LOG_FILE_BASENAME_ENABLE) && XF_LOG_FILE_BASENAME_ENABLE && defined(__FILE_NAME__)
+#define XF_LOG_FILE __FILE_NAME__
+#else
+#define XF_LOG_FILE __FILE__
+#endif
+#endif
+
 // 后端对接的输出对象数目，默认为一个对象
 #ifndef XF_LOG_OBJ_NUM
 #define XF_LOG_OBJ_NUM (1)
@@ -99,6 +115,248 @@ extern "C" {
 #define XF_FORMAT_BUFFER_SIZE 32
 #endif
 
+// 统计计数功能，xf_log_config.h 中如果定义 XF_LOG_STATS_ENABLE 为 1 则开启
+#if defined(XF_LOG_STATS_ENABLE) && XF_LOG_STATS_ENABLE
+#define XF_LOG_STATS_IS_ENABLE (1)
+#else
+#define XF_LOG_STATS_IS_ENABLE (0)
+#endif
+
+// 统计计数的分片数目，各线程分摊写入不同分片，读取时再汇总
+#ifndef XF_LOG_STATS_SHARD_NUM
+#define XF_LOG_STATS_SHARD_NUM (4)
+#endif
+
+// out_func 耗时直方图的桶数，第 i 个桶统计耗时在 [2^(i-1), 2^i) 个 tick 内的调用
+#ifndef XF_LOG_STATS_HIST_NUM
+#define XF_LOG_STATS_HIST_NUM (16)
+#endif
+
+// 调用点统计功能，xf_log_config.h 中如果定义 XF_LOG_CALLSITE_ENABLE 为 1 则开启（依赖 GNU C 语句表达式）
+#if defined(XF_LOG_CALLSITE_ENABLE) && XF_LOG_CALLSITE_ENABLE
+#define XF_LOG_CALLSITE_IS_ENABLE (1)
+#else
+#define XF_LOG_CALLSITE_IS_ENABLE (0)
+#endif
+
+// 调用点报告默认输出的条目数
+#ifndef XF_LOG_CALLSITE_TOP_NUM
+#define XF_LOG_CALLSITE_TOP_NUM (10)
+#endif
+
+// 每个调用点缓存的格式化字符串片段数，文本和格式控制符各占一个，超出时每次输出时解析
+#ifndef XF_LOG_CALLSITE_SPEC_NUM
+#define XF_LOG_CALLSITE_SPEC_NUM (8)
+#endif
+
+// 后端异步输出功能，xf_log_config.h 中如果定义 XF_LOG_ASYNC_ENABLE 为 1 则开启
+#if defined(XF_LOG_ASYNC_ENABLE) && XF_LOG_ASYNC_ENABLE
+#define XF_LOG_ASYNC_IS_ENABLE (1)
+#else
+#define XF_LOG_ASYNC_IS_ENABLE (0)
+#endif
+
+// 每个异步后端的队列长度（记录数）
+#ifndef XF_LOG_QUEUE_SIZE
+#define XF_LOG_QUEUE_SIZE (16)
+#endif
+
+// 异步记录池的记录数，各异步后端共享同一条记录，建议不小于所有异步队列长度之和
+#ifndef XF_LOG_RECORD_NUM
+#define XF_LOG_RECORD_NUM (XF_LOG_QUEUE_SIZE + 4)
+#endif
+
+// 单条异步记录和分片记录正文的最大长度，超出部分会被截断
+#ifndef XF_LOG_RECORD_SIZE
+#define XF_LOG_RECORD_SIZE (256)
+#endif
+
+// 后端行格式功能，xf_log_config.h 中如果定义 XF_LOG_LAYOUT_ENABLE 为 1 则开启
+#if defined(XF_LOG_LAYOUT_ENABLE) && XF_LOG_LAYOUT_ENABLE
+#define XF_LOG_LAYOUT_IS_ENABLE (1)
+#else
+#define XF_LOG_LAYOUT_IS_ENABLE (0)
+#endif
+
+// 行格式编译后的最大操作数，每个字段或一段连续的文本各占一个
+#ifndef XF_LOG_LAYOUT_OP_NUM
+#define XF_LOG_LAYOUT_OP_NUM (24)
+#endif
+
+// 整行输出功能，xf_log_config.h 中如果定义 XF_LOG_LINE_OUT_ENABLE 为 1 则开启
+#if defined(XF_LOG_LINE_OUT_ENABLE) && XF_LOG_LINE_OUT_ENABLE
+#define XF_LOG_LINE_OUT_IS_ENABLE (1)
+#else
+#define XF_LOG_LINE_OUT_IS_ENABLE (0)
+#endif
+
+// 整行输出、静态后端以及中断/信号上下文记录的正文使用的栈上行缓冲的大小，超出部分会被截断
+#ifndef XF_LOG_LINE_SIZE
+#define XF_LOG_LINE_SIZE (256)
+#endif
+
+// 运行时注销后端功能，xf_log_config.h 中如果定义 XF_LOG_DYNAMIC_ENABLE 为 1 则开启
+#if defined(XF_LOG_DYNAMIC_ENABLE) && XF_LOG_DYNAMIC_ENABLE
+#define XF_LOG_DYNAMIC_IS_ENABLE (1)
+#else
+#define XF_LOG_DYNAMIC_IS_ENABLE (0)
+#endif
+
+// 读侧计数的分片数目，各线程分摊到不同分片，注销时等待所有分片清零
+#ifndef XF_LOG_EPOCH_SHARD_NUM
+#define XF_LOG_EPOCH_SHARD_NUM (4)
+#endif
+
+// 中断/信号上下文输出功能，xf_log_config.h 中如果定义 XF_LOG_ISR_ENABLE 为 1 则开启（依赖 GNU C 可变参数宏扩展）
+#if defined(XF_LOG_ISR_ENABLE) && XF_LOG_ISR_ENABLE
+#define XF_LOG_ISR_IS_ENABLE (1)
+#else
+#define XF_LOG_ISR_IS_ENABLE (0)
+#endif
+
+// 中断/信号上下文记录池的槽位数，必须是 2 的幂
+#ifndef XF_LOG_ISR_SLOT_NUM
+#define XF_LOG_ISR_SLOT_NUM (16)
+#endif
+
+// 二进制缓冲区输出功能，xf_log_config.h 中如果定义 XF_LOG_HEX_ENABLE 为 1 则开启
+#if defined(XF_LOG_HEX_ENABLE) && XF_LOG_HEX_ENABLE
+#define XF_LOG_HEX_IS_ENABLE (1)
+#else
+#define XF_LOG_HEX_IS_ENABLE (0)
+#endif
+
+// 二进制缓冲区输出时每行的字节数
+#ifndef XF_LOG_HEX_LINE_WIDTH
+#define XF_LOG_HEX_LINE_WIDTH (16)
+#endif
+
+// 分片缓冲功能，xf_log_config.h 中如果定义 XF_LOG_SHARD_ENABLE 为 1 则开启
+#if defined(XF_LOG_SHARD_ENABLE) && XF_LOG_SHARD_ENABLE
+#define XF_LOG_SHARD_IS_ENABLE (1)
+#else
+#define XF_LOG_SHARD_IS_ENABLE (0)
+#endif
+
+// 分片数目，每个线程固定写入一个分片，线程数不超过分片数时生产者之间没有竞争
+#ifndef XF_LOG_SHARD_NUM
+#define XF_LOG_SHARD_NUM (8)
+#endif
+
+// 每个分片的记录数，必须是 2 的幂
+#ifndef XF_LOG_SHARD_SLOT_NUM
+#define XF_LOG_SHARD_SLOT_NUM (16)
+#endif
+
+// 缓存行大小，分片中生产者和合并者各自修改的字段按此隔开
+#ifndef XF_LOG_CACHE_LINE
+#define XF_LOG_CACHE_LINE (64)
+#endif
+
+// 静态后端功能，xf_log_config.h 中如果定义 XF_LOG_STATIC_ENABLE 为 1 则开启
+// 需要同时定义后端列表 XF_LOG_STATIC_OBJS(X)，每一项为
+// X(out_func, user_args, level, info_level, colorful, tag, file)：
+//   out_func   输出函数名，需要是外部函数，由 xf_log.c 统一声明
+//   user_args  传给输出函数的参数，可以是 NULL 或者已声明对象的地址
+//   level      输出的最高等级，高于此等级的记录不会交给该后端
+//   info_level 等级不高于此值时输出 [文件:行号(函数)]
+//   colorful   是否输出颜色，写文件或者发送到网络的后端一般为 0
+//   tag        只输出该标签的记录，NULL 表示不按标签过滤
+//   file       只输出该文件的记录，与记录中的文件名（XF_LOG_FILE）比较，NULL 表示不按文件过滤
+// 例如（多项时用续行符分行书写）:
+//   #define XF_LOG_STATIC_OBJS(X) X(uart_log_out, NULL, XF_LOG_LVL_INFO, XF_LOG_LVL_ERROR, 1, NULL, NULL)
+// 列表中的后端在编译期展开为直接调用，各列都是常量，为 NULL 的过滤条件在编译期消去，
+// 与 xf_log_register_obj 注册的后端同时存在
+#if defined(XF_LOG_STATIC_ENABLE) && XF_LOG_STATIC_ENABLE
+#define XF_LOG_STATIC_IS_ENABLE (1)
+#ifndef XF_LOG_STATIC_OBJS
+#error "XF_LOG_STATIC_ENABLE requires XF_LOG_STATIC_OBJS(X) in xf_log_config.h"
+#endif
+#else
+#define XF_LOG_STATIC_IS_ENABLE (0)
+#endif
+
+// 输出预算功能，xf_log_config.h 中如果定义 XF_LOG_BUDGET_ENABLE 为 1 则开启
+// 开启后 XF_LOGx 等宏在调用前先比较运行时等级，超出预算时逐级降低等级
+#if defined(XF_LOG_BUDGET_ENABLE) && XF_LOG_BUDGET_ENABLE
+#define XF_LOG_BUDGET_IS_ENABLE (1)
+#else
+#define XF_LOG_BUDGET_IS_ENABLE (0)
+#endif
+
+// 超出预算时最低降到的等级，默认 INFO，ERROR、WARN 始终输出
+#ifndef XF_LOG_BUDGET_MIN_LEVEL
+#define XF_LOG_BUDGET_MIN_LEVEL (XF_LOG_LVL_INFO)
+#endif
+
+// 用量低于预算的此百分比时才认为负载已经回落
+#ifndef XF_LOG_BUDGET_RESTORE_PERCENT
+#define XF_LOG_BUDGET_RESTORE_PERCENT (50)
+#endif
+
+// 连续多少个周期负载回落后才恢复一级，避免在两个等级之间来回切换
+#ifndef XF_LOG_BUDGET_HOLD_NUM
+#define XF_LOG_BUDGET_HOLD_NUM (4)
+#endif
+
+// 恢复后很快又超出预算时，恢复前等待的周期数加倍，最多加到此值，持续过载时不会反复放开
+#ifndef XF_LOG_BUDGET_HOLD_MAX
+#define XF_LOG_BUDGET_HOLD_MAX (64)
+#endif
+
+// 队列满并阻塞等待时让出 CPU 的方式，默认忙等
+#ifndef xf_log_yield
+#define xf_log_yield()
+#endif
+
+// 线程局部存储修饰符，裸机环境下可以定义为空
+#ifndef XF_LOG_THREAD_LOCAL
+#define XF_LOG_THREAD_LOCAL __thread
+#endif
+
+// printf 风格的编译期格式检查，不支持 GNU 属性的编译器下为空
+#ifndef XF_LOG_PRINTF_ATTR
+#if defined(__GNUC__)
+#define XF_LOG_PRINTF_ATTR(fmt_index, args_index) __attribute__((format(printf, fmt_index, args_index)))
+#else
+#define XF_LOG_PRINTF_ATTR(fmt_index, args_index)
+#endif
+#endif
+
+// 原子操作，默认使用 GCC 内建的 __atomic 接口，不支持的平台需要在 xf_log_config.h 中自行实现
+#ifndef xf_log_atomic_add
+#define xf_log_atomic_add(ptr, val) __atomic_fetch_add((ptr), (val), __ATOMIC_RELAXED)
+#endif
+
+#ifndef xf_log_atomic_sub
+#define xf_log_atomic_sub(ptr, val) __atomic_fetch_sub((ptr), (val), __ATOMIC_ACQ_REL)
+#endif
+
+#ifndef xf_log_atomic_load
+#define xf_log_atomic_load(ptr) __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#endif
+
+#ifndef xf_log_atomic_store
+#define xf_log_atomic_store(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELAXED)
+#endif
+
+#ifndef xf_log_atomic_load_acquire
+#define xf_log_atomic_load_acquire(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#endif
+
+#ifndef xf_log_atomic_store_release
+#define xf_log_atomic_store_release(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#endif
+
+#ifndef xf_log_atomic_cas
+#define xf_log_atomic_cas(ptr, expected, desired) \
+    __atomic_compare_exchange_n((ptr), (expected), (desired), 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)
+#endif
+
+#ifndef xf_log_atomic_fence
+#define xf_log_atomic_fence() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
 /* ==================== [Typedefs] ========================================== */
 
 /* ==================== [Global Prototypes] ================================= */
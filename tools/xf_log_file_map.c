@@ -0,0 +1,115 @@
+/**
+ * @file xf_log_file_map.c
+ * @author cangyu (sky.kirto@qq.com)
+ * @brief 把日志中的文件编号 "#编号:" 还原为源文件路径。
+ * @version 0.1
+ * @date 2024-10-23
+ *
+ * @copyright Copyright (c) 2024, CorAL. All rights reserved.
+ *
+ * 编号由 xmake f --file_id=y 编译时生成，对应关系位于 <targetdir>/<target>.fileid，每行 "编号\t路径"。
+ * 用法: xf_log_file_map <fileid> [log]，不指定 log 时从标准输入读取
+ * 例如: xf_log_file_map build/linux/x86_64/release/xf_log.fileid log.log
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ==================== [Defines] =========================================== */
+
+#define FILE_ID_MAX     (4096)
+#define LINE_SIZE       (4096)
+
+/* ==================== [Static Variables] ================================== */
+
+static char *s_path[FILE_ID_MAX] = {0};
+
+/* ==================== [Static Functions] ================================== */
+
+static int map_load(const char *name)
+{
+    char line[LINE_SIZE];
+    FILE *fp = fopen(name, "r");
+    if (fp == NULL) {
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        char *end = NULL;
+        unsigned long id = strtoul(line, &end, 10);
+        if (end == line || *end != '\t' || id >= FILE_ID_MAX) {
+            continue;
+        }
+        end[strcspn(end, "\r\n")] = '\0';
+        free(s_path[id]);
+        s_path[id] = strdup(end + 1);
+    }
+    fclose(fp);
+
+    return 0;
+}
+
+static void line_map(const char *line, FILE *out)
+{
+    const char *p = line;
+
+    // 只替换紧跟 ':' 的已知编号，即默认格式中 "[#编号:行号(函数)]" 的位置
+    while (*p != '\0') {
+        const char *hash = strchr(p, '#');
+        if (hash == NULL) {
+            fputs(p, out);
+            return;
+        }
+        fwrite(p, 1, hash - p, out);
+
+        const char *q = hash + 1;
+        unsigned long id = 0;
+        while (isdigit((unsigned char)*q) && id < FILE_ID_MAX) {
+            id = id * 10 + (*q++ - '0');
+        }
+        if (q > hash + 1 && *q == ':' && id < FILE_ID_MAX && s_path[id] != NULL) {
+            fputs(s_path[id], out);
+        } else {
+            fwrite(hash, 1, q - hash, out);
+        }
+        p = q;
+    }
+}
+
+/* ==================== [Global Functions] ================================== */
+
+int main(int argc, char *argv[])
+{
+    char line[LINE_SIZE];
+    FILE *in = stdin;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <fileid> [log]\n", argv[0]);
+        return 1;
+    }
+    if (map_load(argv[1]) < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    if (argc > 2) {
+        in = fopen(argv[2], "r");
+        if (in == NULL) {
+            perror(argv[2]);
+            return 1;
+        }
+    }
+
+    while (fgets(line, sizeof(line), in) != NULL) {
+        line_map(line, stdout);
+    }
+
+    if (in != stdin) {
+        fclose(in);
+    }
+
+    return 0;
+}
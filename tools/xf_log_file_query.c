@@ -0,0 +1,255 @@
+/**
+ * @file xf_log_file_query.c
+ * @author cangyu (sky.kirto@qq.com)
+ * @brief 借助文件后端生成的索引，只读取时间、等级和 tag 可能符合条件的块。
+ * @version 0.1
+ * @date 2024-10-25
+ *
+ * @copyright Copyright (c) 2024, CorAL. All rights reserved.
+ *
+ * 用法: xf_log_file_query <file> [-s 起始时间] [-e 结束时间] [-l 等级] [-t tag]
+ * 例如: xf_log_file_query ./log.log.1 -s 1000 -e 2000 -l W
+ * 等级为 U/E/W/I/D/V，输出不低于该严重程度的记录；没有 file.idx 时扫描整个文件。
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#define _FILE_OFFSET_BITS 64    // 日志文件可能超过 4 GiB，32 位系统上也使用 64 位的偏移
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "xf_log_backend_file.h"
+
+/* ==================== [Typedefs] ========================================== */
+
+typedef struct _range_t {
+    off_t start;
+    off_t end;
+} range_t;
+
+typedef struct _query_t {
+    uint32_t time_start;
+    uint32_t time_end;
+    uint8_t has_time;
+    uint8_t level;
+    const char *tag;
+    uint32_t tag_bit;
+} query_t;
+
+/* ==================== [Static Variables] ================================== */
+
+static const char s_levels[] = "\0UEWIDV";
+
+/* ==================== [Static Functions] ================================== */
+
+static int range_cmp(const void *a, const void *b)
+{
+    const range_t *x = (const range_t *)a;
+    const range_t *y = (const range_t *)b;
+    return (x->start > y->start) - (x->start < y->start);
+}
+
+static int block_match(const xf_log_file_block_t *block, const query_t *q)
+{
+    if (block->size == 0) {
+        return 0;
+    }
+    if (q->has_time && (block->time_max < block->time_min
+                        || block->time_max < q->time_start || block->time_min > q->time_end)) {
+        return 0;
+    }
+    // 1 << level 中 level 越小越严重，保留 1 ~ q->level
+    if (q->level && !(block->levels & (((1U << (q->level + 1)) - 1) & ~1U))) {
+        return 0;
+    }
+    if (q->tag && !(block->tags & q->tag_bit)) {
+        return 0;
+    }
+    return 1;
+}
+
+// 解析默认格式 "L (time)-tag[...]: msg" 或者 "L tag: msg"，行首可能带颜色
+static int line_match(const char *line, const query_t *q)
+{
+    const char *p = line;
+
+    if (!q->has_time && !q->level && !q->tag) {
+        return 1;
+    }
+    if (p[0] == '\033' && p[1] == '[') {
+        p = strchr(p, 'm');
+        if (p == NULL) {
+            return 0;
+        }
+        p++;
+    }
+    const char *lvl = (*p != '\0') ? strchr(s_levels + 1, *p) : NULL;
+    if (lvl == NULL || p[1] != ' ') {
+        return 0;
+    }
+    if (q->level && lvl - s_levels > q->level) {
+        return 0;
+    }
+    p += 2;
+
+    if (*p == '(') {
+        char *end = NULL;
+        unsigned long time = strtoul(p + 1, &end, 10);
+        if (end[0] != ')' || end[1] != '-') {
+            return 0;
+        }
+        if (q->has_time && (time < q->time_start || time > q->time_end)) {
+            return 0;
+        }
+        p = end + 2;
+    } else if (q->has_time) {
+        return 0;
+    }
+
+    if (q->tag) {
+        size_t len = strlen(q->tag);
+        if (strncmp(p, q->tag, len) != 0 || (p[len] != '[' && p[len] != ':')) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* ==================== [Global Functions] ================================== */
+
+int main(int argc, char *argv[])
+{
+    query_t q = {0, UINT32_MAX, 0, 0, NULL, 0};
+    char name[XF_LOG_FILE_PATH_SIZE + 8];
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:e:l:t:")) != -1) {
+        switch (opt) {
+        case 's':
+            q.time_start = strtoul(optarg, NULL, 0);
+            q.has_time = 1;
+            break;
+        case 'e':
+            q.time_end = strtoul(optarg, NULL, 0);
+            q.has_time = 1;
+            break;
+        case 'l': {
+            const char *lvl = optarg[0] ? strchr(s_levels + 1, optarg[0]) : NULL;
+            if (lvl == NULL) {
+                fprintf(stderr, "unknown level %s\n", optarg);
+                return 1;
+            }
+            q.level = lvl - s_levels;
+            break;
+        }
+        case 't':
+            q.tag = optarg;
+            q.tag_bit = xf_log_file_tag_bit(optarg);
+            break;
+        default:
+            goto usage;
+        }
+    }
+    if (optind >= argc) {
+        goto usage;
+    }
+
+    FILE *fp = fopen(argv[optind], "r");
+    if (fp == NULL) {
+        perror(argv[optind]);
+        return 1;
+    }
+    fseeko(fp, 0, SEEK_END);
+    off_t file_size = ftello(fp);
+
+    // 读取索引，同时求出仍在写入的进程最后一个块的末尾，之后的部分还没有索引
+    xf_log_file_block_t *blocks = NULL;
+    size_t num = 0;
+    snprintf(name, sizeof(name), "%s" XF_LOG_FILE_INDEX_SUFFIX, argv[optind]);
+    FILE *idx = fopen(name, "rb");
+    if (idx != NULL) {
+        fseek(idx, 0, SEEK_END);
+        num = ftell(idx) / sizeof(xf_log_file_block_t);
+        fseek(idx, 0, SEEK_SET);
+        blocks = malloc(num * sizeof(xf_log_file_block_t) + 1);
+        num = fread(blocks, sizeof(xf_log_file_block_t), num, idx);
+        fclose(idx);
+    }
+
+    range_t *ranges = malloc((num + 1) * sizeof(range_t));
+    uint32_t *pids = malloc((num + 1) * sizeof(uint32_t));
+    size_t pid_num = 0;
+    size_t count = 0;
+    off_t tail = (blocks == NULL) ? 0 : file_size;
+    for (size_t i = num; i-- > 0;) {
+        off_t end = (off_t)(blocks[i].offset + blocks[i].size);
+        size_t k = 0;
+        while (k < pid_num && pids[k] != blocks[i].pid) {
+            k++;
+        }
+        if (k == pid_num) {
+            // 倒序遍历时第一次遇到的进程号就是该进程最后一个块，已关闭的进程没有未索引的记录
+            pids[pid_num++] = blocks[i].pid;
+            if (!(blocks[i].flags & XF_LOG_FILE_BLOCK_CLOSED) && end < tail) {
+                tail = end;
+            }
+        }
+        if (block_match(&blocks[i], &q)) {
+            ranges[count].start = (off_t)blocks[i].offset;
+            ranges[count].end = end;
+            count++;
+        }
+    }
+    free(pids);
+    size_t matched = count;
+    if (tail < file_size) {
+        ranges[count].start = tail;
+        ranges[count].end = file_size;
+        count++;
+    }
+
+    // 合并重叠的块，每段只读一次
+    qsort(ranges, count, sizeof(range_t), range_cmp);
+    size_t merged = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (merged && ranges[i].start <= ranges[merged - 1].end) {
+            if (ranges[i].end > ranges[merged - 1].end) {
+                ranges[merged - 1].end = ranges[i].end;
+            }
+        } else {
+            ranges[merged++] = ranges[i];
+        }
+    }
+
+    char *line = NULL;
+    size_t cap = 0;
+    off_t scanned = 0;
+    for (size_t i = 0; i < merged; i++) {
+        fseeko(fp, ranges[i].start, SEEK_SET);
+        off_t pos = ranges[i].start;
+        ssize_t n;
+        while (pos < ranges[i].end && (n = getline(&line, &cap, fp)) > 0) {
+            if (line_match(line, &q)) {
+                fwrite(line, 1, n, stdout);
+            }
+            pos += n;
+        }
+        scanned += pos - ranges[i].start;
+    }
+
+    fprintf(stderr, "%lu/%lu blocks matched, %lld/%lld bytes scanned\n", (unsigned long)matched,
+            (unsigned long)num, (long long)scanned, (long long)file_size);
+
+    free(line);
+    free(ranges);
+    free(blocks);
+    fclose(fp);
+
+    return 0;
+
+usage:
+    fprintf(stderr, "usage: %s <file> [-s start] [-e end] [-l U|E|W|I|D|V] [-t tag]\n", argv[0]);
+    return 1;
+}
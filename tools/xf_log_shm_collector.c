@@ -0,0 +1,89 @@
+/**
+ * @file xf_log_shm_collector.c
+ * @author cangyu (sky.kirto@qq.com)
+ * @brief xf_log 共享内存后端的收集进程，把共享内存环中的记录写入文件。
+ * @version 0.1
+ * @date 2024-10-21
+ *
+ * @copyright Copyright (c) 2024, CorAL. All rights reserved.
+ *
+ * 用法: xf_log_shm_collector <name> <file> [slot_num] [slot_size]
+ * 例如: xf_log_shm_collector /xf_log ./log.log 1024 256
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include "xf_log_backend_shm.h"
+
+/* ==================== [Static Variables] ================================== */
+
+static volatile sig_atomic_t s_stop = 0;
+
+/* ==================== [Static Functions] ================================== */
+
+static void on_signal(int sig)
+{
+    s_stop = 1;
+}
+
+static void file_write(const char *str, size_t len, void *arg)
+{
+    fwrite(str, 1, len, (FILE *)arg);
+}
+
+/* ==================== [Global Functions] ================================== */
+
+int main(int argc, char *argv[])
+{
+    xf_log_shm_t shm;
+    uint32_t slot_num = 1024;
+    uint32_t slot_size = 256;
+
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <name> <file> [slot_num] [slot_size]\n", argv[0]);
+        return 1;
+    }
+    if (argc > 3) {
+        slot_num = strtoul(argv[3], NULL, 0);
+    }
+    if (argc > 4) {
+        slot_size = strtoul(argv[4], NULL, 0);
+    }
+
+    FILE *fp = fopen(argv[2], "a");
+    if (fp == NULL) {
+        perror(argv[2]);
+        return 1;
+    }
+    if (xf_log_shm_open(&shm, argv[1], slot_num, slot_size) < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    // 所有文件 IO 都在这里完成，生产者只写共享内存
+    uint32_t dropped = xf_log_shm_dropped(&shm);
+    while (!s_stop) {
+        if (xf_log_shm_read(&shm, file_write, fp, 100) == 0) {
+            continue;
+        }
+        uint32_t now = xf_log_shm_dropped(&shm);
+        if (now != dropped) {
+            fprintf(fp, "xf_log_shm: %lu records dropped\n", (unsigned long)(now - dropped));
+            dropped = now;
+        }
+        fflush(fp);
+    }
+
+    // 退出前把剩余的记录写完
+    xf_log_shm_read(&shm, file_write, fp, 0);
+    fclose(fp);
+    xf_log_shm_close(&shm);
+
+    return 0;
+}
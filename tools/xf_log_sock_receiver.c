@@ -0,0 +1,92 @@
+/**
+ * @file xf_log_sock_receiver.c
+ * @author cangyu (sky.kirto@qq.com)
+ * @brief xf_log 本地套接字后端的接收端，代替本地日志代理，把收到的数据报逐行输出。
+ * @version 0.1
+ * @date 2024-10-22
+ *
+ * @copyright Copyright (c) 2024, CorAL. All rights reserved.
+ *
+ * 用法: xf_log_sock_receiver <path> [count]
+ * 例如: xf_log_sock_receiver /tmp/xf_log.sock
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/* ==================== [Static Variables] ================================== */
+
+static volatile sig_atomic_t s_stop = 0;
+
+/* ==================== [Static Functions] ================================== */
+
+static void on_signal(int sig)
+{
+    s_stop = 1;
+}
+
+/* ==================== [Global Functions] ================================== */
+
+int main(int argc, char *argv[])
+{
+    struct sockaddr_un addr = {0};
+    unsigned long count = 0;
+    char buf[65536];
+
+    if (argc < 2 || strlen(argv[1]) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "usage: %s <path> [count]\n", argv[0]);
+        return 1;
+    }
+    if (argc > 2) {
+        count = strtoul(argv[2], NULL, 0);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return 1;
+    }
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, argv[1]);
+    unlink(argv[1]);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    // 不设置 SA_RESTART，收到信号时 recv 返回 EINTR
+    struct sigaction sa = {0};
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    // 每个数据报是一条完整的记录
+    for (unsigned long n = 0; !s_stop && (count == 0 || n < count); n++) {
+        ssize_t len = recv(fd, buf, sizeof(buf), 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("recv");
+            break;
+        }
+        fwrite(buf, 1, len, stdout);
+        if (len == 0 || buf[len - 1] != '\n') {
+            fputc('\n', stdout);
+        }
+        fflush(stdout);
+    }
+
+    close(fd);
+    unlink(argv[1]);
+
+    return 0;
+}
@@ -1,5 +1,27 @@
+option("file_id")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Replace __FILE__ in log records with numeric file ids")
+option_end()
+
+-- 为每个源文件分配编号并定义 XF_LOG_FILE_ID，编号与路径的对应关系写入 <targetdir>/<target>.fileid
+rule("xf_log.file_id")
+    on_config(function (target)
+        if not has_config("file_id") then
+            return
+        end
+        local lines = {}
+        for id, sourcefile in ipairs(target:sourcefiles()) do
+            target:fileconfig_add(sourcefile, {defines = "XF_LOG_FILE_ID=" .. id})
+            table.insert(lines, id .. "\t" .. path.relative(sourcefile, os.projectdir()))
+        end
+        io.writefile(path.join(target:targetdir(), target:name() .. ".fileid"), table.concat(lines, "\n") .. "\n")
+    end)
+rule_end()
+
 target("xf_log")
     set_kind("binary")
+    add_rules("xf_log.file_id")
     add_cflags("-Wall")
     add_cflags("-std=gnu99 -O0 -g")
     add_files("src/*.c")
@@ -7,3 +29,49 @@ target("xf_log")
     add_includedirs("src")
     add_includedirs("src/utils")
     add_includedirs("example")
+
+-- 后端不进入示例程序，单独编译一份静态库，保证改动核心代码时后端也能发现编译错误
+target("xf_log_backend")
+    set_kind("static")
+    add_cflags("-Wall")
+    add_cflags("-std=gnu99 -O0 -g")
+    add_files("src/*.c")
+    add_files("src/backend/*.c")
+    add_includedirs("src")
+    add_includedirs("src/backend")
+    add_includedirs("src/utils")
+    add_includedirs("example")
+
+target("xf_log_shm_collector")
+    set_kind("binary")
+    add_cflags("-Wall")
+    add_cflags("-std=gnu99 -O0 -g")
+    add_files("src/backend/xf_log_backend_shm.c")
+    add_files("tools/xf_log_shm_collector.c")
+    add_includedirs("src")
+    add_includedirs("src/backend")
+    add_includedirs("src/utils")
+    add_includedirs("example")
+    add_syslinks("rt")
+
+target("xf_log_sock_receiver")
+    set_kind("binary")
+    add_cflags("-Wall")
+    add_cflags("-std=gnu99 -O0 -g")
+    add_files("tools/xf_log_sock_receiver.c")
+
+target("xf_log_file_map")
+    set_kind("binary")
+    add_cflags("-Wall")
+    add_cflags("-std=gnu99 -O0 -g")
+    add_files("tools/xf_log_file_map.c")
+
+target("xf_log_file_query")
+    set_kind("binary")
+    add_cflags("-Wall")
+    add_cflags("-std=gnu99 -O0 -g")
+    add_files("tools/xf_log_file_query.c")
+    add_includedirs("src")
+    add_includedirs("src/backend")
+    add_includedirs("src/utils")
+    add_includedirs("example")